@@ -3,48 +3,10 @@
 #include <cmath>
 #include <vector>
 #include <sys/sysinfo.h>
-#include <sys/time.h>
+#include "harness.hpp"
 
 #define INDEX(N,i,j) (i*N + j)
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 // Kernel to compute the 5-point stencil and accumulate the norm
 __global__ void stencil_kernel(const float *Mat_A, float *Mat_Stencil, int N, int M, float *FNorm) {
     int row = blockIdx.y * blockDim.y + threadIdx.y + 1;
@@ -82,15 +44,11 @@ int main(int argc, char *argv[]) {
     int N = atoi(argv[2]);
     int M = atoi(argv[3]);
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-
     std::vector<float> Mat_A(N * M, 1.0f);
     std::vector<float> Mat_Stencil((N - 2) * (M - 2), 0.0f);
     float FNorm = 0.0f;
-    double elapsed_time[10], Average = 0.0;
-
-    Calibrate(&ClkPerSec, NSecClk);
+    harness::Options opts = harness::Options::FromEnv(loops);
+    harness::Series stencil_time("cuda_stencil", opts);
 
     // Allocate device memory
     float *d_Mat_A, *d_Mat_Stencil, *d_FNorm;
@@ -103,13 +61,13 @@ int main(int argc, char *argv[]) {
     dim3 numBlocks((M + threadsPerBlock.x - 1) / threadsPerBlock.x,
                    (N + threadsPerBlock.y - 1) / threadsPerBlock.y);
 
-    for (int count = 0; count < loops; count++) {
+    for (int count = 0; count < stencil_time.iterations(); count++) {
 
         if(FNorm == 0.0f)
           FNorm = 1.0f;
         else
           FNorm = 1.0f;
-        unsigned long long start = rdtsc();
+        harness::Timer timer(opts.clock);
         cudaMemcpy(d_FNorm, &FNorm, sizeof(float), cudaMemcpyHostToDevice);
         cudaMemcpy(d_Mat_A, Mat_A.data(), N * M * sizeof(float), cudaMemcpyHostToDevice);
 
@@ -128,7 +86,7 @@ int main(int argc, char *argv[]) {
 
         cudaMemcpy(Mat_A.data(), d_Mat_A, N * M * sizeof(float), cudaMemcpyDeviceToHost);
         cudaMemcpy(&FNorm, d_FNorm, sizeof(float), cudaMemcpyDeviceToHost);
-        unsigned long long end = rdtsc();
+        double ttc = timer.Elapsed();
 
         /*for(int i=0;i<N*M;i+=M)
         {
@@ -137,8 +95,8 @@ int main(int argc, char *argv[]) {
             printf("\n");
         }*/
 
-        elapsed_time[count] = (double)(end - start) / ClkPerSec;
-        printf("TTC : %.12f\n", elapsed_time[count]);
+        stencil_time.Record(ttc);
+        printf("TTC : %.12f\n", ttc);
     }
 
 
@@ -150,11 +108,8 @@ int main(int argc, char *argv[]) {
     }*/ 
 
     // Print average time
-    for (int count = 1; count < loops; count++) {
-        Average += elapsed_time[count];
-    }
-    Average /= (loops - 1);
-    printf("Average Computation Time: %.12f\n", Average);
+    printf("Average Computation Time: %.12f\n", stencil_time.Summary().mean);
+    stencil_time.Print();
 
     cudaFree(d_Mat_A);
     cudaFree(d_Mat_Stencil);
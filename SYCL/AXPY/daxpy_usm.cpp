@@ -7,49 +7,12 @@
 #include <vector>
 #include <sycl/sycl.hpp>          //# sycl namespace
 #include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
-#include <sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
 
 using namespace sycl;
 namespace mkl = oneapi::mkl;  //# shorten mkl namespace
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc, char *argv[]) {
 
     //# scalar multipliers
@@ -60,19 +23,15 @@ int main(int argc, char *argv[]) {
     const int m = atoi(argv[4]);
     const int k = atoi(argv[5]);
 
-    queue cpu_queue(cpu_selector_v);
-    queue gpu_queue(gpu_selector_v);
+    //# Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
     queue q;
     if (strcmp(argv[2], "cpu") == 0)
-        q = cpu_queue;
+        q = queue(cpu_selector_v);
     else
-        q = gpu_queue;
+        q = queue(gpu_selector_v);
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[500];
-    double Average = 0.0;
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+    harness::Series axpy_time("daxpy_usm", opts);
     
     device my_device = q.get_device();
     std::cout << "Device: " << my_device.get_info<info::device::name>() << "\n";
@@ -93,11 +52,9 @@ int main(int argc, char *argv[]) {
     //for(int i=0;i<n*m;i++)
     //    vector2_usm[i] = 20.0;
 
-    Calibrate(&ClkPerSec,NSecClk);
-
     int64_t incx = 1;
     int64_t incy = 1;
-    for(int count=0;count<iteration_count;count++)
+    for(int count=0;count<axpy_time.iterations();count++)
     {
         //printf("Starting Loop!\n");
 	for(int i=0;i<n*m;i++)
@@ -106,21 +63,27 @@ int main(int argc, char *argv[]) {
 	for(int i=0;i<n*m;i++)
 	    vector2_usm[i] = 20.0;
 
-        start = rdtsc(); 
+        harness::Timer timer(opts.clock);
 	axpy_done = mkl::blas::axpy(q, n*m, alpha, vector1_usm, incx, vector2_usm, incy, axpy_dependencies);
         //# We must now wait for the given event to finish before accessing any data involved in the operation
         //# Otherwise, we may access data before the operation has completed, or before it has been returned to the host
         axpy_done.wait();
-	end = rdtsc();
-        elapsed_count[count] = (double)(end-start)/ClkPerSec;
-        //printf("TTC : %0.12f\n",elapsed_count[count]);
+        axpy_time.Record(timer.Elapsed());
     }
 
-    for(int count=1;count<iteration_count;count++)
-        Average += elapsed_count[count];
-
-    Average = Average/(iteration_count - 1);
-    printf("\nTime to compute Matrix Product = %0.12f \n",Average);
+    printf("\nTime to compute AXPY = %0.12f \n",axpy_time.Summary().mean);
+    axpy_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "axpy";
+    run.variant = "daxpy_usm";
+    run.device = my_device.get_info<info::device::name>();
+    run.memory = "usm_shared";
+    run.precision = "fp64";
+    run.sizes = {{"n", n}, {"m", m}};
+    run.flops = 2.0 * n * m;
+    run.bytes = 3.0 * n * m * sizeof(double);
+    harness::WriteRecords(run, axpy_time);
 
     //# free usm pointers
     sycl::free(vector1_usm, q);
@@ -3,53 +3,18 @@
 //
 // SPDX-License-Identifier: MIT
 // =============================================================
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <sycl/sycl.hpp>          //# sycl namespace
 #include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
-#include <sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
+#include "../Pipeline.hpp"  //# chunked host <-> device streaming
 
 using namespace sycl;
 namespace mkl = oneapi::mkl;  //# shorten mkl namespace
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc, char *argv[]) {
 
     //# scalar multipliers
@@ -58,20 +23,18 @@ int main(int argc, char *argv[]) {
     const int iteration_count = atoi(argv[1]);
     const int n = atoi(argv[3]);
     const int m = atoi(argv[4]);
+    //# Optional trailing "stream [chunks] [depth]" overlaps the copies with the axpy
+    const pipeline::Options stream = pipeline::Options::FromArgs(argc, argv, 5);
 
-    queue cpu_queue(cpu_selector_v);
-    queue gpu_queue(gpu_selector_v);
+    //# Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
     queue q;
     if (strcmp(argv[2], "cpu") == 0)
-        q = cpu_queue;
+        q = queue(cpu_selector_v);
     else
-        q = gpu_queue;
+        q = queue(gpu_selector_v);
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[500];
-    double Average = 0.0;
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+    harness::Series axpy_time(stream.enabled ? "saxpy_dcopy stream" : "saxpy_dcopy", opts);
     
     device my_device = q.get_device();
     std::cout << "Device: " << my_device.get_info<info::device::name>() << "\n";
@@ -82,8 +45,9 @@ int main(int argc, char *argv[]) {
     
     //# Here, we allocate USM pointers for each matrix, using the special 'malloc_shared' function
     //# Make sure to template the function with the correct precision, and pass in our queue to the function call
-    float *vector1 = static_cast<float*>(malloc(n*m*sizeof(float)));
-    float *vector2 = static_cast<float*>(malloc(n*m*sizeof(float)));
+    //# Streaming needs pinned host memory for the copies to run asynchronously
+    float *vector1 = stream.enabled ? malloc_host<float>(n*m,q) : static_cast<float*>(malloc(n*m*sizeof(float)));
+    float *vector2 = stream.enabled ? malloc_host<float>(n*m,q) : static_cast<float*>(malloc(n*m*sizeof(float)));
 
     for(int i=0;i<n*m;i++)
         vector1[i] = 10.0;
@@ -91,44 +55,107 @@ int main(int argc, char *argv[]) {
     for(int i=0;i<n*m;i++)
         vector2[i] = 20.0;
 
-    auto *vector1_usm = static_cast<float*>(malloc_device<float>(n*m,q));
-    auto *vector2_usm = static_cast<float*>(malloc_device<float>(n*m,q));
-
-    Calibrate(&ClkPerSec,NSecClk);
+    //# When streaming the device only holds one chunk per pipeline slot
+    const size_t total = (size_t)n*m;
+    const size_t chunk = (total + stream.chunks - 1) / stream.chunks;
+    const size_t device_count = stream.enabled ? chunk*stream.depth : total;
+    auto *vector1_usm = static_cast<float*>(malloc_device<float>(device_count,q));
+    auto *vector2_usm = static_cast<float*>(malloc_device<float>(device_count,q));
 
     int64_t incx = 1;
     int64_t incy = 1;
-    for(int count=0;count<iteration_count;count++)
+    if(stream.enabled)
     {
-        //printf("Starting Loop!\n");
-        start = rdtsc();
-
-	auto e1 = q.memcpy(vector1_usm,vector1,(sizeof(float)*n*m));
-        auto e2 = q.memcpy(vector2_usm,vector2,(sizeof(float)*n*m));
-
-        e1.wait();
-        e2.wait();
-
-        //start = rdtsc();
-	axpy_done = mkl::blas::axpy(q, n*m, alpha, vector1_usm, incx, vector2_usm, incy, axpy_dependencies);
-        //# We must now wait for the given event to finish before accessing any data involved in the operation
-        //# Otherwise, we may access data before the operation has completed, or before it has been returned to the host
-        axpy_done.wait();
-	end = rdtsc();
-        elapsed_count[count] = (double)(end-start)/ClkPerSec;
-        //printf("TTC : %0.12f\n",elapsed_count[count]);
+        pipeline::Streamer streamer(q, stream, opts.clock);
+        pipeline::Report report;
+        for(int count=0;count<axpy_time.iterations();count++)
+        {
+            //# Copy in x and y, axpy and copy y back, one chunk at a time
+            report = streamer.Run([&](queue &sq, int slot, int c) {
+                auto [begin, end] = pipeline::Chunk(total, stream.chunks, c);
+                const size_t len = end - begin;
+                float *x = vector1_usm + slot*chunk, *y = vector2_usm + slot*chunk;
+
+                pipeline::Stage stage;
+                stage.in = {sq.memcpy(x, vector1 + begin, sizeof(float)*len),
+                            sq.memcpy(y, vector2 + begin, sizeof(float)*len)};
+                stage.compute = {mkl::blas::axpy(sq, len, alpha, x, incx, y, incy)};
+                stage.out = {sq.memcpy(vector2 + begin, y, sizeof(float)*len)};
+                return stage;
+            });
+            axpy_time.Record(report.wall);
+        }
+        report.Print();
+    }
+    else
+    {
+        for(int count=0;count<axpy_time.iterations();count++)
+        {
+            //printf("Starting Loop!\n");
+            harness::Timer timer(opts.clock);
+
+            auto e1 = q.memcpy(vector1_usm,vector1,(sizeof(float)*n*m));
+            auto e2 = q.memcpy(vector2_usm,vector2,(sizeof(float)*n*m));
+
+            e1.wait();
+            e2.wait();
+
+            axpy_done = mkl::blas::axpy(q, n*m, alpha, vector1_usm, incx, vector2_usm, incy, axpy_dependencies);
+            //# We must now wait for the given event to finish before accessing any data involved in the operation
+            //# Otherwise, we may access data before the operation has completed, or before it has been returned to the host
+            axpy_done.wait();
+            axpy_time.Record(timer.Elapsed());
+        }
     }
 
-    for(int count=1;count<iteration_count;count++)
-        Average += elapsed_count[count];
+    printf("\nTime to compute AXPY = %0.12f \n",axpy_time.Summary().mean);
+    axpy_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "axpy";
+    run.variant = stream.enabled ? "saxpy_dcopy_stream" : "saxpy_dcopy";
+    run.device = my_device.get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp32";
+    run.sizes = {{"n", n}, {"m", m}};
+    run.flops = 2.0 * n * m;
+    //# x and y are read and y written; the dcopy variants also time the two host to device copies
+    run.bytes = 5.0 * n * m * sizeof(float);
+    if(stream.enabled)
+    {
+        //# Streaming also copies y back
+        run.bytes += 1.0 * n * m * sizeof(float);
+        run.sizes.push_back({"chunks", stream.chunks});
+        run.sizes.push_back({"depth", stream.depth});
+    }
+    harness::WriteRecords(run, axpy_time);
 
-    Average = Average/(iteration_count - 1);
-    printf("\nTime to compute Matrix Product = %0.12f \n",Average);
+    //# verify y.  Streaming copies y back every pass, so the host copy holds one axpy per
+    //# pass; without streaming every pass restarts from the host y and the result stays on the device
+    double passes = 1.0;
+    if(stream.enabled)
+        passes = axpy_time.iterations();
+    else
+        q.memcpy(vector2,vector2_usm,sizeof(float)*n*m).wait();
+    const double expected = 20.0 + passes * alpha * 10.0;
+    size_t wrong = 0;
+    for(size_t i=0;i<total;i++)
+        wrong += std::fabs(vector2[i] - expected) > 1e-6 * expected;
+    wrong == 0 ? std::cout << "Verified: y = " << expected << "\n"
+               : std::cout << "Failed: " << wrong << " entries of y differ from " << expected << "\n";
 
     //# free usm pointers
-    free(vector1);
-    free(vector2);
+    if(stream.enabled)
+    {
+        sycl::free(vector1, q);
+        sycl::free(vector2, q);
+    }
+    else
+    {
+        free(vector1);
+        free(vector2);
+    }
     sycl::free(vector1_usm, q);
     sycl::free(vector2_usm, q);
-    return 0;
+    return wrong == 0 ? 0 : 1;
 }
@@ -0,0 +1,281 @@
+//==============================================================
+// Shared pieces of the oneMKL GEMM drivers: precisions, problem shapes,
+// exactly representable operands and the host check of a product.
+//
+// A Problem is one C (m x n) = op(A) (m x k) * op(B) (k x n) with its
+// storage: row- or column-major layout, the transposes and optional
+// padding of the leading dimensions.  The leading dimensions and element
+// counts are derived from that in one place and checked against oneMKL's
+// rules, and Gemm() calls the oneMKL routine of the layout.  The drivers
+// take the storage as trailing `layout row|col`, `trans nn|nt|tn|tt` and
+// `pad <elements>` arguments.
+//
+// A precision names the input type of A and B and the type C is
+// accumulated and stored in; fp16 and bf16 are oneMKL's mixed-precision
+// GEMMs with half / bfloat16 inputs and float C.
+//
+// The operands are multiples of 1/4 in [-0.5, 0.5], exact in every
+// input type, so with float or double accumulation every product is
+// exact up to k of about 4 million and the checks (MaxError for whole
+// column-major products, SampledError for any Problem) can be strict.
+// =============================================================
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "oneapi/mkl/blas.hpp"
+
+namespace gemm_bench {
+
+template <class TA, class TC>
+struct Precision {
+    using A = TA;   // A and B
+    using C = TC;   // C, alpha, beta and accumulation
+};
+
+using Fp64 = Precision<double, double>;
+using Fp32 = Precision<float, float>;
+using Fp16 = Precision<sycl::half, float>;
+using Bf16 = Precision<sycl::ext::oneapi::bfloat16, float>;
+
+// `batch` independent m x n x k products.
+struct Shape {
+    int64_t m, n, k, batch = 1;
+
+    std::string Name() const
+    {
+        return std::to_string(m) + "x" + std::to_string(n) + "x" + std::to_string(k) + "x" + std::to_string(batch);
+    }
+
+    double Flops() const { return 2.0 * m * n * k * batch; }
+};
+
+// "MxNxK[xBATCH],..." e.g. "32x32x32x4096,512x512x512".
+inline std::vector<Shape> ParseShapes(const std::string &arg)
+{
+    std::vector<Shape> shapes;
+    std::stringstream list(arg);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        std::vector<int64_t> dims;
+        std::stringstream fields(item);
+        std::string field;
+        while (std::getline(fields, field, 'x')) {
+            char *end = nullptr;
+            long long value = std::strtoll(field.c_str(), &end, 10);
+            if (field.empty() || *end != '\0' || value < 1)
+                throw std::invalid_argument("bad shape '" + item + "', expected MxNxK[xBATCH]");
+            dims.push_back(value);
+        }
+        if (dims.size() != 3 && dims.size() != 4)
+            throw std::invalid_argument("bad shape '" + item + "', expected MxNxK[xBATCH]");
+        shapes.push_back({dims[0], dims[1], dims[2], dims.size() == 4 ? dims[3] : 1});
+    }
+    if (shapes.empty())
+        throw std::invalid_argument("no shapes in '" + arg + "'");
+    return shapes;
+}
+
+struct Problem {
+    int64_t m = 0, n = 0, k = 0;
+    oneapi::mkl::layout layout = oneapi::mkl::layout::col_major;
+    oneapi::mkl::transpose transa = oneapi::mkl::transpose::nontrans;
+    oneapi::mkl::transpose transb = oneapi::mkl::transpose::nontrans;
+    int64_t pad = 0;   // extra elements in every leading dimension
+
+    bool ColMajor() const { return layout == oneapi::mkl::layout::col_major; }
+    static bool Trans(oneapi::mkl::transpose t) { return t != oneapi::mkl::transpose::nontrans; }
+
+    // Stored (rows, cols) of A, B and C
+    std::pair<int64_t, int64_t> StoredA() const { return Trans(transa) ? std::make_pair(k, m) : std::make_pair(m, k); }
+    std::pair<int64_t, int64_t> StoredB() const { return Trans(transb) ? std::make_pair(n, k) : std::make_pair(k, n); }
+    std::pair<int64_t, int64_t> StoredC() const { return {m, n}; }
+
+    // A column-major matrix is laid out by columns of `rows` elements, a row-major one by rows
+    int64_t Ld(std::pair<int64_t, int64_t> s) const { return (ColMajor() ? s.first : s.second) + pad; }
+    int64_t lda() const { return Ld(StoredA()); }
+    int64_t ldb() const { return Ld(StoredB()); }
+    int64_t ldc() const { return Ld(StoredC()); }
+
+    // Elements to allocate: the leading dimension times the other extent
+    size_t Size(std::pair<int64_t, int64_t> s) const { return (size_t)Ld(s) * (ColMajor() ? s.second : s.first); }
+    size_t SizeA() const { return Size(StoredA()); }
+    size_t SizeB() const { return Size(StoredB()); }
+    size_t SizeC() const { return Size(StoredC()); }
+
+    // Offset of element (i, j) of a stored matrix
+    int64_t At(int64_t i, int64_t j, int64_t ld) const { return ColMajor() ? i + j * ld : i * ld + j; }
+    // Offsets of op(A)(i, l), op(B)(l, j) and C(i, j)
+    int64_t AtA(int64_t i, int64_t l) const { return Trans(transa) ? At(l, i, lda()) : At(i, l, lda()); }
+    int64_t AtB(int64_t l, int64_t j) const { return Trans(transb) ? At(j, l, ldb()) : At(l, j, ldb()); }
+    int64_t AtC(int64_t i, int64_t j) const { return At(i, j, ldc()); }
+
+    // The same product seen column-major: a row-major C = op(A) op(B) is
+    // the column-major C^T = op(B)^T op(A)^T on the same memory, so A and
+    // B, m and n and the transposes swap places.
+    Problem ColumnMajor() const
+    {
+        if (ColMajor())
+            return *this;
+        return {n, m, k, oneapi::mkl::layout::col_major, transb, transa, pad};
+    }
+
+    std::string Name() const
+    {
+        return std::string(ColMajor() ? "col" : "row") + "_" + (Trans(transa) ? "t" : "n") + (Trans(transb) ? "t" : "n") +
+               (pad > 0 ? "_pad" + std::to_string(pad) : "");
+    }
+
+    // oneMKL's argument rules, checked independently of how Ld() derives them.
+    void Validate(size_t element_size) const
+    {
+        if (m < 1 || n < 1 || k < 1)
+            throw std::invalid_argument("gemm dimensions must be positive");
+        if (pad < 0)
+            throw std::invalid_argument("pad must not be negative");
+        // Column-major: ld >= rows of the stored matrix; row-major: >= its columns
+        const int64_t min_lda = ColMajor() ? (Trans(transa) ? k : m) : (Trans(transa) ? m : k);
+        const int64_t min_ldb = ColMajor() ? (Trans(transb) ? n : k) : (Trans(transb) ? k : n);
+        const int64_t min_ldc = ColMajor() ? m : n;
+        if (lda() < min_lda || ldb() < min_ldb || ldc() < min_ldc)
+            throw std::logic_error("leading dimension below the oneMKL minimum for " + Name());
+        for (auto s : {StoredA(), StoredB(), StoredC()})
+            if ((double)Ld(s) * (ColMajor() ? s.second : s.first) * element_size > (double)std::numeric_limits<int64_t>::max())
+                throw std::invalid_argument("matrix too large for " + Name());
+    }
+
+    // Reads trailing "layout row|col", "trans nn|nt|tn|tt" and "pad <elements>"
+    // from argv[first..argc); other arguments are left to the driver.
+    void StorageFromArgs(int argc, char *argv[], int first)
+    {
+        for (int i = first; i + 1 < argc; i++) {
+            const std::string key = argv[i], value = argv[i + 1];
+            if (key == "layout") {
+                if (value != "row" && value != "col")
+                    throw std::invalid_argument("layout is row or col");
+                layout = value == "row" ? oneapi::mkl::layout::row_major : oneapi::mkl::layout::col_major;
+            } else if (key == "trans") {
+                if (value.size() != 2 || value.find_first_not_of("nt") != std::string::npos)
+                    throw std::invalid_argument("trans is nn, nt, tn or tt");
+                transa = value[0] == 't' ? oneapi::mkl::transpose::trans : oneapi::mkl::transpose::nontrans;
+                transb = value[1] == 't' ? oneapi::mkl::transpose::trans : oneapi::mkl::transpose::nontrans;
+            } else if (key == "pad") {
+                char *end = nullptr;
+                pad = std::strtoll(value.c_str(), &end, 10);
+                if (value.empty() || *end != '\0' || pad < 0)
+                    throw std::invalid_argument("pad needs a non-negative element count");
+            } else {
+                continue;
+            }
+            i++;
+        }
+    }
+};
+
+// Sizes of a result record: the dimensions, leading dimensions and storage.
+inline std::vector<std::pair<std::string, long long>> Sizes(const Problem &p)
+{
+    return {{"m", p.m}, {"n", p.n}, {"k", p.k}, {"lda", p.lda()}, {"ldb", p.ldb()}, {"ldc", p.ldc()},
+            {"row_major", !p.ColMajor()}, {"transa", Problem::Trans(p.transa)}, {"transb", Problem::Trans(p.transb)}};
+}
+
+// oneMKL gemm in the layout of p, for USM pointers or buffers.
+template <class TS, class A, class B, class C>
+auto Gemm(sycl::queue &q, const Problem &p, TS alpha, A &&a, B &&b, TS beta, C &&c,
+          const std::vector<sycl::event> &deps)
+{
+    if (p.ColMajor())
+        return oneapi::mkl::blas::column_major::gemm(q, p.transa, p.transb, p.m, p.n, p.k, alpha, a, p.lda(), b, p.ldb(),
+                                                     beta, c, p.ldc(), deps);
+    return oneapi::mkl::blas::row_major::gemm(q, p.transa, p.transb, p.m, p.n, p.k, alpha, a, p.lda(), b, p.ldb(), beta,
+                                              c, p.ldc(), deps);
+}
+
+template <class TS, class T>
+void Gemm(sycl::queue &q, const Problem &p, TS alpha, sycl::buffer<T, 1> &a, sycl::buffer<T, 1> &b, TS beta,
+          sycl::buffer<T, 1> &c)
+{
+    if (p.ColMajor())
+        oneapi::mkl::blas::column_major::gemm(q, p.transa, p.transb, p.m, p.n, p.k, alpha, a, p.lda(), b, p.ldb(), beta,
+                                              c, p.ldc());
+    else
+        oneapi::mkl::blas::row_major::gemm(q, p.transa, p.transb, p.m, p.n, p.k, alpha, a, p.lda(), b, p.ldb(), beta, c,
+                                           p.ldc());
+}
+
+// Element i of operand `operand` (0 = A, 1 = B) of product b.  Varies with
+// b so a wrong batch stride shows up in the check.
+inline float Value(int64_t i, int64_t b, int operand)
+{
+    return (float)((i * 7 + b * 3 + operand) % 5 - 2) * 0.25f;
+}
+
+// Fills data[0, count) on the device with the values of operand
+// `operand` of product 0, so the data never has to pass through the host.
+template <class T>
+sycl::event Fill(sycl::queue &q, T *data, size_t count, int operand, const std::vector<sycl::event> &deps = {})
+{
+    return q.parallel_for(sycl::range<1>(count), deps, [=](sycl::id<1> i) { data[i] = T(Value(i, 0, operand)); });
+}
+
+// Max abs difference of column-major C against A * B computed in double.
+template <class TA, class TC>
+double MaxError(const TA *a, const TA *b, const TC *c, int64_t m, int64_t n, int64_t k)
+{
+    double err = 0.0;
+    for (int64_t j = 0; j < n; j++)
+        for (int64_t i = 0; i < m; i++) {
+            double sum = 0.0;
+            for (int64_t l = 0; l < k; l++)
+                sum += (double)a[i + l * m] * (double)b[l + j * k];
+            err = std::max(err, std::fabs((double)c[i + j * m] - sum));
+        }
+    return err;
+}
+
+// Max abs difference between C and scale * op(A) op(B), computed in
+// double, over the four corners of C and `samples` pseudo-random
+// entries.  Each sample costs one dot product of length k, so the check
+// stays cheap for any size.
+template <class TA, class TC>
+double SampledError(const Problem &p, const TA *a, const TA *b, const TC *c, double scale = 1.0, int samples = 256)
+{
+    double err = 0.0;
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (int s = 0; s < samples + 4; s++) {
+        int64_t i, j;
+        if (s < 4) {
+            i = (s & 1) ? p.m - 1 : 0;
+            j = (s & 2) ? p.n - 1 : 0;
+        } else {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            i = (int64_t)((state >> 33) % (uint64_t)p.m);
+            j = (int64_t)((state >> 11) % (uint64_t)p.n);
+        }
+        double sum = 0.0;
+        for (int64_t l = 0; l < p.k; l++)
+            sum += (double)a[p.AtA(i, l)] * (double)b[p.AtB(l, j)];
+        err = std::max(err, std::fabs((double)c[p.AtC(i, j)] - scale * sum));
+    }
+    return err;
+}
+
+// Allowed MaxError.  The products are exact, so anything beyond rounding
+// noise is a wrong result.
+template <class TC>
+double Tolerance(int64_t k)
+{
+    return (sizeof(TC) == sizeof(double) ? 1e-12 : 1e-5) * k;
+}
+
+}  // namespace gemm_bench
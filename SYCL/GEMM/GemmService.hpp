@@ -0,0 +1,235 @@
+//==============================================================
+// Persistent oneMKL GEMM executor for long-running services.
+//
+// A standalone GEMM driver pays for its queue, its allocations and the
+// first-call setup of the oneMKL kernels on every launch.  An Executor
+// owns one queue and a pool of device blocks for its whole lifetime and
+// runs a stream of requests back to back without host synchronization:
+//
+//  - Device memory comes from the pool in power-of-two buckets.  A
+//    released block keeps the event of its last use, and the next request
+//    that draws it makes its first command depend on that event, so
+//    blocks are recycled while earlier products are still running.
+//  - Every request fills its A and B on the device, then runs its gemm
+//    depending on the fills; only Wait() blocks the host.
+//  - Check() runs one request synchronously and compares C with a host
+//    product (SampledError).  Run once per distinct request before timing,
+//    it also warms up the oneMKL kernel of each shape, precision and layout.
+//
+// The queue profiles when the device supports it; Wait() then reports the
+// summed device time of the gemms (unknown if oneMKL returned an event
+// without profiling data), so the per-call overhead of the service
+// is the wall time per call minus the gemm time per call.
+//
+// Requests are read from text, one per line:
+//   fp32|fp64 m n k [layout row|col] [trans nn|nt|tn|tt] [pad p] [repeat r]
+// '#' starts a comment.
+// =============================================================
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "GemmBench.hpp"
+#include "../Pipeline.hpp"  // DeviceSeconds
+
+namespace gemm_service {
+
+struct Request {
+    gemm_bench::Problem problem;
+    bool fp64 = false;
+    int repeat = 1;   // consecutive executions of the request
+
+    std::string Name() const
+    {
+        return std::string(fp64 ? "fp64 " : "fp32 ") + std::to_string(problem.m) + "x" + std::to_string(problem.n) +
+               "x" + std::to_string(problem.k) + " " + problem.Name();
+    }
+};
+
+// Parses the request lines of `in`; `source` names it in error messages.
+inline std::vector<Request> ReadRequests(std::istream &in, const std::string &source)
+{
+    std::vector<Request> requests;
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::vector<std::string> tokens;
+        for (std::string t; fields >> t;)
+            tokens.push_back(t);
+        if (tokens.empty())
+            continue;
+
+        const std::string where = source + ":" + std::to_string(number) + ": ";
+        try {
+            Request r;
+            if (tokens.size() < 4 || (tokens[0] != "fp32" && tokens[0] != "fp64"))
+                throw std::invalid_argument("expected fp32|fp64 m n k [options]");
+            r.fp64 = tokens[0] == "fp64";
+            int64_t *dims[3] = {&r.problem.m, &r.problem.n, &r.problem.k};
+            for (int d = 0; d < 3; d++) {
+                char *end = nullptr;
+                *dims[d] = std::strtoll(tokens[1 + d].c_str(), &end, 10);
+                if (*end != '\0' || *dims[d] < 1)
+                    throw std::invalid_argument("dimensions must be positive integers");
+            }
+            std::vector<char *> args;
+            for (auto &t : tokens)
+                args.push_back(&t[0]);
+            r.problem.StorageFromArgs((int)args.size(), args.data(), 4);
+            for (size_t i = 4; i + 1 < tokens.size(); i++)
+                if (tokens[i] == "repeat") {
+                    r.repeat = std::atoi(tokens[i + 1].c_str());
+                    if (r.repeat < 1)
+                        throw std::invalid_argument("repeat must be positive");
+                }
+            r.problem.Validate(r.fp64 ? sizeof(double) : sizeof(float));
+            requests.push_back(r);
+        } catch (const std::exception &e) {
+            throw std::invalid_argument(where + e.what());
+        }
+    }
+    return requests;
+}
+
+class Executor {
+ public:
+    explicit Executor(const sycl::queue &q)
+        : profiled_(q.get_device().has(sycl::aspect::queue_profiling)),
+          q_(q.get_context(), q.get_device(),
+             profiled_ ? sycl::property_list{sycl::property::queue::enable_profiling()} : sycl::property_list{})
+    {
+    }
+
+    ~Executor()
+    {
+        q_.wait();
+        for (void *p : allocations_)
+            sycl::free(p, q_);
+    }
+
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    sycl::queue &queue() { return q_; }
+    bool profiled() const { return profiled_; }
+
+    // Enqueues every execution of r; returns without waiting.
+    void Run(const Request &r)
+    {
+        for (int i = 0; i < r.repeat; i++)
+            r.fp64 ? Submit<double>(r.problem, nullptr) : Submit<float>(r.problem, nullptr);
+    }
+
+    // Runs r once, waits and returns the max sampled error of its C.
+    double Check(const Request &r)
+    {
+        double error = 0.0;
+        r.fp64 ? Submit<double>(r.problem, &error) : Submit<float>(r.problem, &error);
+        return error;
+    }
+
+    // Waits for everything enqueued and returns the summed device time of
+    // its gemms, or a negative value when it is unknown: no profiling, or
+    // a gemm event without profiling data.
+    double Wait()
+    {
+        q_.wait_and_throw();
+        double total = profiled_ ? 0.0 : -1.0, seconds;
+        for (auto &e : gemms_)
+            if (total >= 0.0)
+                total = pipeline::DeviceSeconds(e, seconds) ? total + seconds : -1.0;
+        gemms_.clear();
+        return total;
+    }
+
+    // Pool statistics: blocks allocated, their bytes, and draws served from the pool
+    size_t blocks() const { return allocations_.size(); }
+    size_t pooled_bytes() const { return pooled_bytes_; }
+    long long reused() const { return reused_; }
+
+ private:
+    struct Block {
+        void *ptr = nullptr;
+        size_t bytes = 0;      // bucket size
+        sycl::event ready;     // last use; the next user depends on it
+    };
+
+    static size_t Bucket(size_t bytes)
+    {
+        size_t bucket = 256;
+        while (bucket < bytes)
+            bucket *= 2;
+        return bucket;
+    }
+
+    Block Acquire(size_t bytes)
+    {
+        std::vector<Block> &free = free_[Bucket(bytes)];
+        if (!free.empty()) {
+            Block b = free.back();
+            free.pop_back();
+            reused_++;
+            return b;
+        }
+        Block b;
+        b.bytes = Bucket(bytes);
+        b.ptr = sycl::malloc_device(b.bytes, q_);
+        if (b.ptr == nullptr)
+            throw std::runtime_error("gemm_service: out of device memory");
+        allocations_.push_back(b.ptr);
+        pooled_bytes_ += b.bytes;
+        return b;
+    }
+
+    void Release(Block b, const sycl::event &last_use)
+    {
+        b.ready = last_use;
+        free_[b.bytes].push_back(b);
+    }
+
+    // One execution of p: fill A and B, gemm, give the blocks back.  With
+    // error != nullptr it waits and checks C against the host.
+    template <class T>
+    void Submit(const gemm_bench::Problem &p, double *error)
+    {
+        Block a = Acquire(p.SizeA() * sizeof(T)), b = Acquire(p.SizeB() * sizeof(T)), c = Acquire(p.SizeC() * sizeof(T));
+        T *A = static_cast<T *>(a.ptr), *B = static_cast<T *>(b.ptr), *C = static_cast<T *>(c.ptr);
+
+        sycl::event fill_a = gemm_bench::Fill(q_, A, p.SizeA(), 0, {a.ready});
+        sycl::event fill_b = gemm_bench::Fill(q_, B, p.SizeB(), 1, {b.ready});
+        sycl::event gemm = gemm_bench::Gemm(q_, p, T(1), A, B, T(0), C, {fill_a, fill_b, c.ready});
+        gemms_.push_back(gemm);
+
+        if (error != nullptr) {
+            std::vector<T> A_h(p.SizeA()), B_h(p.SizeB()), C_h(p.SizeC());
+            q_.memcpy(A_h.data(), A, sizeof(T) * A_h.size(), gemm);
+            q_.memcpy(B_h.data(), B, sizeof(T) * B_h.size(), gemm);
+            q_.memcpy(C_h.data(), C, sizeof(T) * C_h.size(), gemm);
+            q_.wait_and_throw();
+            *error = gemm_bench::SampledError(p, A_h.data(), B_h.data(), C_h.data());
+            gemms_.clear();
+        }
+
+        Release(a, gemm);
+        Release(b, gemm);
+        Release(c, gemm);
+    }
+
+    bool profiled_;
+    sycl::queue q_;
+    std::map<size_t, std::vector<Block>> free_;   // by bucket size
+    std::vector<void *> allocations_;
+    std::vector<sycl::event> gemms_;   // since the last Wait()
+    size_t pooled_bytes_ = 0;
+    long long reused_ = 0;
+};
+
+}  // namespace gemm_service
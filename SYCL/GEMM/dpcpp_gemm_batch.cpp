@@ -0,0 +1,331 @@
+//==============================================================
+// Copyright © 2023 Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sycl/sycl.hpp>          //# sycl namespace
+#include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
+#include "harness.hpp"
+#include "report.hpp"
+#include "GemmBench.hpp"
+
+//# Throughput of many small and medium GEMMs, where launch overhead rather than the
+//# product dominates.  Every precision x shape of the run is timed in up to four modes:
+//#   loop     one gemm call per product of the batch
+//#   strided  one gemm_batch call, the products at fixed strides
+//#   group    one gemm_batch call through the group (pointer array) API
+//#   groups   one group-API call for all shapes of the run, one group per shape
+//# fp16 and bf16 multiply half / bfloat16 inputs into float C; combinations the device
+//# or the oneMKL backend does not support are reported and skipped.  Three products of
+//# every batch are checked against a host product.
+//#
+//#   dpcpp_gemm_batch <iterations> <cpu|gpu> [--precisions fp64,fp32,fp16,bf16]
+//#       [--shapes 32x32x32x4096,128x128x128x512,512x512x512x16] [--modes loop,strided,group,groups]
+
+using namespace sycl;
+namespace mkl = oneapi::mkl;  //# shorten mkl namespace
+
+template <class T>
+using shared_vector = std::vector<T, usm_allocator<T, usm::alloc::shared>>;
+
+struct Settings {
+    std::vector<std::string> precisions = {"fp64", "fp32", "fp16", "bf16"};
+    std::vector<gemm_bench::Shape> shapes = gemm_bench::ParseShapes("32x32x32x4096,128x128x128x512,512x512x512x16");
+    std::vector<std::string> modes = {"loop", "strided", "group", "groups"};
+};
+
+std::vector<std::string> SplitList(const std::string &arg, const std::vector<std::string> &allowed)
+{
+    std::vector<std::string> items;
+    std::stringstream in(arg);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (std::find(allowed.begin(), allowed.end(), item) == allowed.end())
+            throw std::invalid_argument("unknown value '" + item + "' in '" + arg + "'");
+        items.push_back(item);
+    }
+    if (items.empty())
+        throw std::invalid_argument("empty list '" + arg + "'");
+    return items;
+}
+
+//# Column-major operands of one shape on the device, product b of the batch at b * stride.
+//# The host keeps A and B for the check.
+template <class P>
+struct Operands {
+    using TA = typename P::A;
+    using TC = typename P::C;
+
+    Operands(queue &q, const gemm_bench::Shape &shape)
+        : q(q), s(shape), stride_a(shape.m * shape.k), stride_b(shape.k * shape.n), stride_c(shape.m * shape.n),
+          A_h(stride_a * shape.batch), B_h(stride_b * shape.batch)
+    {
+        for (int64_t b = 0; b < s.batch; b++) {
+            for (int64_t i = 0; i < stride_a; i++) A_h[b * stride_a + i] = TA(gemm_bench::Value(i, b, 0));
+            for (int64_t i = 0; i < stride_b; i++) B_h[b * stride_b + i] = TA(gemm_bench::Value(i, b, 1));
+        }
+        A = malloc_device<TA>(A_h.size(), q);
+        B = malloc_device<TA>(B_h.size(), q);
+        C = malloc_device<TC>(stride_c * s.batch, q);
+        if (A == nullptr || B == nullptr || C == nullptr) {
+            Free();
+            throw std::runtime_error("out of device memory for " + s.Name());
+        }
+        q.memcpy(A, A_h.data(), sizeof(TA) * A_h.size());
+        q.memcpy(B, B_h.data(), sizeof(TA) * B_h.size());
+        q.wait();
+    }
+    ~Operands() { Free(); }
+    Operands(const Operands &) = delete;
+    Operands &operator=(const Operands &) = delete;
+
+    void Free()
+    {
+        if (A) sycl::free(A, q);
+        if (B) sycl::free(B, q);
+        if (C) sycl::free(C, q);
+        A = B = nullptr;
+        C = nullptr;
+    }
+
+    //# Max error of products 0, batch/2 and batch-1
+    double Check()
+    {
+        double err = 0.0;
+        std::vector<TC> C_h(stride_c);
+        for (int64_t b : {(int64_t)0, s.batch / 2, s.batch - 1}) {
+            q.memcpy(C_h.data(), C + b * stride_c, sizeof(TC) * stride_c).wait();
+            err = std::max(err, gemm_bench::MaxError(A_h.data() + b * stride_a, B_h.data() + b * stride_b, C_h.data(),
+                                                     s.m, s.n, s.k));
+        }
+        return err;
+    }
+
+    queue &q;
+    gemm_bench::Shape s;
+    int64_t stride_a, stride_b, stride_c;
+    std::vector<TA> A_h, B_h;
+    TA *A = nullptr, *B = nullptr;
+    TC *C = nullptr;
+};
+
+//# Argument arrays of the group API, one group per shape.  oneMKL reads them on the
+//# device, so they live in shared USM.
+template <class P>
+struct GroupArrays {
+    using TA = typename P::A;
+    using TC = typename P::C;
+
+    GroupArrays(queue &q, const std::vector<Operands<P> *> &ops)
+        : transa(q), transb(q), m(q), n(q), k(q), lda(q), ldb(q), ldc(q), size(q), alpha(q), beta(q), a(q), b(q), c(q)
+    {
+        for (auto *op : ops) {
+            transa.push_back(mkl::transpose::nontrans);
+            transb.push_back(mkl::transpose::nontrans);
+            m.push_back(op->s.m);
+            n.push_back(op->s.n);
+            k.push_back(op->s.k);
+            lda.push_back(op->s.m);
+            ldb.push_back(op->s.k);
+            ldc.push_back(op->s.m);
+            size.push_back(op->s.batch);
+            alpha.push_back(TC(1));
+            beta.push_back(TC(0));
+            for (int64_t i = 0; i < op->s.batch; i++) {
+                a.push_back(op->A + i * op->stride_a);
+                b.push_back(op->B + i * op->stride_b);
+                c.push_back(op->C + i * op->stride_c);
+            }
+        }
+    }
+
+    shared_vector<mkl::transpose> transa, transb;
+    shared_vector<int64_t> m, n, k, lda, ldb, ldc, size;
+    shared_vector<TC> alpha, beta;
+    shared_vector<const TA *> a, b;
+    shared_vector<TC *> c;
+};
+
+//# Times one mode over `ops`, checks the products and writes the records.
+//# Returns false if a check failed.
+template <class P>
+bool Time(queue &q, const harness::Options &opts, const std::string &precision, const std::string &mode,
+          const std::vector<Operands<P> *> &ops)
+{
+    using TA = typename P::A;
+    using TC = typename P::C;
+    const auto nontrans = mkl::transpose::nontrans;
+    const TC alpha = 1, beta = 0;
+
+    std::unique_ptr<GroupArrays<P>> groups;
+    if (mode == "group" || mode == "groups")
+        groups = std::make_unique<GroupArrays<P>>(q, ops);
+
+    //# NaN in every C, so a product that was not written fails the check
+    for (auto *op : ops)
+        q.memset(op->C, 0xff, sizeof(TC) * op->stride_c * op->s.batch);
+    q.wait();
+
+    std::string shape_name = ops.size() == 1 ? ops[0]->s.Name() : "all shapes";
+    harness::Series gemm_time("dpcpp_gemm_batch " + precision + " " + shape_name + " " + mode, opts);
+    for (int count = 0; count < gemm_time.iterations(); count++) {
+        harness::Timer timer(opts.clock);
+        if (mode == "loop") {
+            for (auto *op : ops)
+                for (int64_t i = 0; i < op->s.batch; i++)
+                    mkl::blas::gemm(q, nontrans, nontrans, op->s.m, op->s.n, op->s.k, alpha, op->A + i * op->stride_a,
+                                    op->s.m, op->B + i * op->stride_b, op->s.k, beta, op->C + i * op->stride_c, op->s.m);
+        } else if (mode == "strided") {
+            auto *op = ops[0];
+            mkl::blas::gemm_batch(q, nontrans, nontrans, op->s.m, op->s.n, op->s.k, alpha, op->A, op->s.m, op->stride_a,
+                                  op->B, op->s.k, op->stride_b, beta, op->C, op->s.m,
+                                  op->stride_c, op->s.batch);
+        } else {
+            mkl::blas::gemm_batch(q, groups->transa.data(), groups->transb.data(), groups->m.data(), groups->n.data(),
+                                  groups->k.data(), groups->alpha.data(), groups->a.data(), groups->lda.data(),
+                                  groups->b.data(), groups->ldb.data(), groups->beta.data(), groups->c.data(),
+                                  groups->ldc.data(), (int64_t)ops.size(), groups->size.data());
+        }
+        q.wait_and_throw();
+        gemm_time.Record(timer.Elapsed());
+    }
+
+    double flops = 0.0, bytes = 0.0, err = 0.0;
+    int64_t products = 0;
+    bool ok = true;
+    for (auto *op : ops) {
+        flops += op->s.Flops();
+        //# A and B read, C written (beta = 0)
+        bytes += (double(op->stride_a + op->stride_b) * sizeof(TA) + double(op->stride_c) * sizeof(TC)) * op->s.batch;
+        products += op->s.batch;
+        double e = op->Check();
+        err = std::max(err, e);
+        ok = ok && e <= gemm_bench::Tolerance<TC>(op->s.k);
+    }
+
+    const double seconds = gemm_time.Summary().median;
+    printf("%-5s %-20s %-8s %12.6f s %10.3f us/gemm %10.2f GFLOP/s  max error %g%s\n", precision.c_str(),
+           shape_name.c_str(), mode.c_str(), seconds, 1e6 * seconds / products, 1e-9 * flops / seconds, err,
+           ok ? "" : "  FAILED");
+    gemm_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "gemm";
+    run.variant = "dpcpp_gemm_batch_" + mode;
+    run.device = q.get_device().get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = precision;
+    if (ops.size() == 1)
+        run.sizes = {{"m", ops[0]->s.m}, {"n", ops[0]->s.n}, {"k", ops[0]->s.k}, {"batch", ops[0]->s.batch}};
+    else
+        run.sizes = {{"shapes", (long long)ops.size()}, {"batch", products}};
+    run.flops = flops;
+    run.bytes = bytes;
+    harness::WriteRecords(run, gemm_time);
+    return ok;
+}
+
+//# All shapes and modes of one precision.  Returns false if a check failed.
+template <class P>
+bool RunPrecision(queue &q, const harness::Options &opts, const std::string &precision, const Settings &settings)
+{
+    bool ok = true;
+    std::vector<std::unique_ptr<Operands<P>>> operands;
+    std::vector<Operands<P> *> all;
+    try {
+        for (const auto &shape : settings.shapes) {
+            operands.push_back(std::make_unique<Operands<P>>(q, shape));
+            all.push_back(operands.back().get());
+        }
+    } catch (const std::exception &e) {
+        std::cout << precision << ": skipped (" << e.what() << ")\n";
+        return true;
+    }
+
+    for (const auto &mode : settings.modes) {
+        //# groups covers the whole run in one call, the other modes one shape per call
+        std::vector<std::vector<Operands<P> *>> calls;
+        if (mode == "groups") {
+            if (all.size() > 1) calls.push_back(all);
+        } else {
+            for (auto *op : all) calls.push_back({op});
+        }
+        for (const auto &ops : calls) {
+            try {
+                ok = Time<P>(q, opts, precision, mode, ops) && ok;
+            } catch (const std::exception &e) {
+                //# e.g. oneapi::mkl::unimplemented for a mixed-precision gemm_batch
+                std::cout << precision << " " << mode << ": skipped (" << e.what() << ")\n";
+            }
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <iterations> <cpu|gpu> [--precisions fp64,fp32,fp16,bf16]\n"
+                  << "       [--shapes MxNxK[xBATCH],...] [--modes loop,strided,group,groups]\n";
+        return 1;
+    }
+    const int iteration_count = atoi(argv[1]);
+
+    Settings settings;
+    try {
+        for (int i = 3; i < argc; i += 2) {
+            std::string flag = argv[i];
+            if (i + 1 >= argc)
+                throw std::invalid_argument("missing value for " + flag);
+            std::string value = argv[i + 1];
+            if (flag == "--precisions")
+                settings.precisions = SplitList(value, {"fp64", "fp32", "fp16", "bf16"});
+            else if (flag == "--shapes")
+                settings.shapes = gemm_bench::ParseShapes(value);
+            else if (flag == "--modes")
+                settings.modes = SplitList(value, {"loop", "strided", "group", "groups"});
+            else
+                throw std::invalid_argument("unknown option " + flag);
+        }
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    //# Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
+    queue q;
+    if (strcmp(argv[2], "cpu") == 0)
+        q = queue(cpu_selector_v);
+    else
+        q = queue(gpu_selector_v);
+
+    device my_device = q.get_device();
+    std::cout << "Device: " << my_device.get_info<info::device::name>() << "\n";
+
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+    bool ok = true;
+    for (const auto &precision : settings.precisions) {
+        if (precision == "fp64" && !my_device.has(aspect::fp64))
+            std::cout << "fp64: skipped (device has no fp64)\n";
+        else if (precision == "fp16" && !my_device.has(aspect::fp16))
+            std::cout << "fp16: skipped (device has no fp16)\n";
+        else if (precision == "fp64")
+            ok = RunPrecision<gemm_bench::Fp64>(q, opts, precision, settings) && ok;
+        else if (precision == "fp32")
+            ok = RunPrecision<gemm_bench::Fp32>(q, opts, precision, settings) && ok;
+        else if (precision == "fp16")
+            ok = RunPrecision<gemm_bench::Fp16>(q, opts, precision, settings) && ok;
+        else
+            ok = RunPrecision<gemm_bench::Bf16>(q, opts, precision, settings) && ok;
+    }
+
+    std::cout << (ok ? "Verified: all products match the host\n" : "Failed: some products differ from the host\n");
+    return ok ? 0 : 1;
+}
@@ -7,54 +7,21 @@
 #include <vector>
 #include <sycl/sycl.hpp>          //# sycl namespace
 #include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
-#include <sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
+#include "GemmBench.hpp"  //# layout, transposes, leading dimensions and the residual check
 
 //# The following project performs matrix multiplication using oneMKL / DPC++ with buffers.
 //# We will execute the simple operation A * B = C
-//# The matrix B is set equal to the identity matrix such that A * B = A * I
-//# After performing the computation, we will verify A * I = C -> A = C
+//# A and B are filled on the host with the repeating pattern of gemm_bench::Value (GemmBench.hpp)
+//# The storage is set by trailing "layout row|col", "trans nn|nt|tn|tt" and "pad <elements>"
+//# arguments (default column-major, no transposes, no padding)
+//# After the timed passes, gemm_bench::SampledError compares C with a double-precision host
+//# product at its four corners and 256 pseudo-random entries; the exit status reports the result
 
 using namespace sycl;
 namespace mkl = oneapi::mkl;  //# shorten mkl namespace
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc, char *argv[]) {
 
     //# dimensions
@@ -66,38 +33,41 @@ int main(int argc, char *argv[]) {
     
     //# scalar multipliers
     
-    float alpha = 1.0, beta = 1.0;
+    double alpha = 1.0, beta = 1.0;
 
     const int iteration_count = atoi(argv[1]);
     const int n = atoi(argv[3]);
     const int m = atoi(argv[4]);
     const int k = atoi(argv[5]);
 
-    int ldA = m, ldB = k, ldC = m;
-    queue cpu_queue(cpu_selector_v);
-    queue gpu_queue(gpu_selector_v);
+    //# Leading dimensions and sizes follow from the layout, the transposes and the padding
+    gemm_bench::Problem problem{m, n, k};
+    try {
+        problem.StorageFromArgs(argc, argv, 6);
+        problem.Validate(sizeof(double));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    //# Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
     queue q;
     if (strcmp(argv[2], "cpu") == 0)
-        q = cpu_queue;
+        q = queue(cpu_selector_v);
     else
-        q = gpu_queue;
+        q = queue(gpu_selector_v);
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[10];
-    double Average = 0.0;
-    
-    //# transpose status of matrices
-    
-    mkl::transpose transA = mkl::transpose::nontrans;
-    mkl::transpose transB = mkl::transpose::nontrans;
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+    harness::Series gemm_time("dpcpp_gemm_buffers " + problem.Name(), opts);
     
     //# matrix data
     
-    std::vector<double> A(m*k, 20.0); // = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0};
-    std::vector<double> B(k*n, 10.0); // = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
-    std::vector<double> C(m*n, 0.0); // = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    std::vector<double> A(problem.SizeA());
+    std::vector<double> B(problem.SizeB());
+    std::vector<double> C(problem.SizeC(), 0.0);
+    for(size_t i=0;i<A.size();i++)
+        A[i] = gemm_bench::Value(i, 0, 0);
+    for(size_t i=0;i<B.size();i++)
+        B[i] = gemm_bench::Value(i, 0, 1);
 
     //### Step 1 - Create a queue with default selector.
     
@@ -119,46 +89,48 @@ int main(int argc, char *argv[]) {
     //### Step 3 - Execute gemm operation.
     //# Here, we need only pass in our queue and other familiar matrix multiplication parameters.
     //# This includes the dimensions and data buffers for matrices A, B, and C.
-    Calibrate(&ClkPerSec,NSecClk);
-
 
-    for(int count=0;count<iteration_count;count++)
+    for(int count=0;count<gemm_time.iterations();count++)
     {
-        start = rdtsc();    
-        mkl::blas::gemm(q, transA, transB, m, n, k, alpha, A_buffer, ldA, B_buffer, ldB, beta, C_buffer, ldC);
+        harness::Timer timer(opts.clock);
+        gemm_bench::Gemm(q, problem, alpha, A_buffer, B_buffer, beta, C_buffer);
         host_accessor C_acc(C_buffer, read_only);
-	end = rdtsc();
-        elapsed_count[count] = (double)(end-start)/ClkPerSec;
-        printf("TTC : %f\n",elapsed_count[count]);
+        double ttc = timer.Elapsed();
+        gemm_time.Record(ttc);
+        printf("TTC : %f\n",ttc);
     }
 
 
     //### Step 6 - Observe creation of accessors to retrieve data from A_buffer and C_buffer.
     
     host_accessor A_acc(A_buffer, read_only);
+    host_accessor B_acc(B_buffer, read_only);
     host_accessor C_acc(C_buffer, read_only);
 
-    for(int count=1;count<iteration_count;count++)
-        Average += elapsed_count[count];
-
-    Average = Average/(iteration_count-1);
-    printf("\nTime to compute Matrix Product = %0.12f \n",Average);
-
-    //int status = 0;
-
-    // verify C matrix using accessor to observe values held in C_buffer
+    printf("\nTime to compute Matrix Product = %0.12f \n",gemm_time.Summary().mean);
+    gemm_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "gemm";
+    run.variant = "dpcpp_gemm_buffers";
+    run.device = my_device.get_info<info::device::name>();
+    run.memory = "buffer";
+    run.precision = "fp64";
+    run.sizes = gemm_bench::Sizes(problem);
+    run.flops = 2.0 * m * n * k;
+    //# A and B are read once, C is read and written (beta = 1)
+    run.bytes = (double(m) * k + double(k) * n + 2.0 * m * n) * sizeof(double);
+    harness::WriteRecords(run, gemm_time);
+
+    // verify C matrix using accessor to observe values held in C_buffer: beta = 1, so C
+    // has accumulated one product per pass
     
     std::cout << std::endl;
-    //std::cout << "C = " << std::endl;
-    //for (int i = 0; i < m; ++i) {
-    //    for (int j = 0; j < n; ++j) {
-    //        if (A_acc[i*m+j] != C_acc[i*m+j]) status = 1;
-            //std::cout << C_acc[i*m+j] << " ";
-    //    }
-        //std::cout << std::endl;
-    //}
-    //std::cout << std::endl;
-
-    //status == 0 ? std::cout << "Verified: A = C" << std::endl : std::cout << "Failed: A != C" << std::endl;
-    return 0;
+    const double passes = gemm_time.iterations();
+    const double error = gemm_bench::SampledError(problem, &A_acc[0], &B_acc[0], &C_acc[0], passes);
+    const int status = error <= passes * gemm_bench::Tolerance<double>(k) ? 0 : 1;
+
+    status == 0 ? std::cout << "Verified: C = A * B (" << problem.Name() << ", max sampled error " << error << ")" << std::endl
+                : std::cout << "Failed: C != A * B (" << problem.Name() << ", max sampled error " << error << ")" << std::endl;
+    return status;
 }
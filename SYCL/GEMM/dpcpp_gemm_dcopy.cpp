@@ -7,54 +7,24 @@
 #include <vector>
 #include <sycl/sycl.hpp>          //# sycl namespace
 #include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
-#include <sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
+#include "../Pipeline.hpp"  //# chunked host <-> device streaming
+#include "GemmBench.hpp"      //# layout, transposes, leading dimensions and the residual check
 
 // # The following project performs matrix multiplication using oneMKL / DPC++ with Unified Shared Memory (USM)
 // # We will execute the simple operation A * B = C
-// # The matrix B is set equal to the identity matrix such that A * B = A * I
-// # After performing the computation, we will verify A * I = C -> A = C
+// # A and B are filled on the host with the repeating pattern of gemm_bench::Value (GemmBench.hpp)
+// # With a trailing "stream [chunks] [depth]" argument the columns of B and C are streamed
+// # through the device in chunks so the copies overlap the gemm of the previous chunk
+// # The storage is set by trailing "layout row|col", "trans nn|nt|tn|tt" and "pad <elements>"
+// # arguments (default column-major, no transposes, no padding)
+// # After the timed passes, gemm_bench::SampledError compares C with a double-precision host
+// # product at its four corners and 256 pseudo-random entries; the exit status reports the result
 
 using namespace sycl;
 namespace mkl = oneapi::mkl;  //# shorten mkl namespace
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc, char *argv[]) {
 
     //# dimensions
@@ -67,26 +37,34 @@ int main(int argc, char *argv[]) {
     const int n = atoi(argv[3]);
     const int m = atoi(argv[4]);
     const int k = atoi(argv[5]);
+    const pipeline::Options stream = pipeline::Options::FromArgs(argc, argv, 6);
+
+    //# Leading dimensions and sizes follow from the layout, the transposes and the padding.
+    //# Streaming works on the column-major view of the product (a row-major product is
+    //# the column-major C^T = B^T A^T), whose B and C are cut into column panels.
+    gemm_bench::Problem problem{m, n, k};
+    try {
+        problem.StorageFromArgs(argc, argv, 6);
+        problem.Validate(sizeof(float));
+        if (stream.enabled && gemm_bench::Problem::Trans(problem.ColumnMajor().transb))
+            throw std::invalid_argument("stream needs contiguous panels: trans nn or tn (col), nn or nt (row)");
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    const gemm_bench::Problem cm = problem.ColumnMajor();
 
-    int ldA = m, ldB = k, ldC = m;
-
-    queue cpu_queue(cpu_selector_v);
-    queue gpu_queue(gpu_selector_v);
+    //# Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
     queue q;
     if (strcmp(argv[2], "cpu") == 0)
-        q = cpu_queue;
+        q = queue(cpu_selector_v);
     else
-        q = gpu_queue;
+        q = queue(gpu_selector_v);
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end1,end2;
-    double elapsed_count[10],elapsed_trf[10];
-    double Average1 = 0.0,Average2 = 0.0;
-    
-    //# transpose status of matrices
-    mkl::transpose transA = mkl::transpose::nontrans;
-    mkl::transpose transB = mkl::transpose::nontrans;
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+    const std::string name = std::string(stream.enabled ? "dpcpp_gemm_dcopy stream " : "dpcpp_gemm_dcopy ") + problem.Name();
+    harness::Series gemm_time(name, opts);
+    harness::Series transfer_time(name + " transfer", opts);
 
     //### Step 1 - Create a queue with default selector.
     //queue q;
@@ -103,20 +81,20 @@ int main(int argc, char *argv[]) {
     //# Here, we allocate USM pointers for each matrix, using the special 'malloc_shared' function
     //# Make sure to template the function with the correct precision, and pass in our queue to the function call
 
-    float *A_h = static_cast<float*>(malloc(n*k*sizeof(float)));
-    float *B_h = static_cast<float*>(malloc(k*m*sizeof(float)));
-    float *C_h = static_cast<float*>(malloc(n*m*sizeof(float)));    
+    //# op(A) is m x k, op(B) is k x n and C is m x n, stored as set by the problem
+    //# Streaming needs pinned host memory for the copies to run asynchronously
+    const size_t A_size = problem.SizeA(), B_size = problem.SizeB(), C_size = problem.SizeC();
+    float *A_h = stream.enabled ? malloc_host<float>(A_size,q) : static_cast<float*>(malloc(A_size*sizeof(float)));
+    float *B_h = stream.enabled ? malloc_host<float>(B_size,q) : static_cast<float*>(malloc(B_size*sizeof(float)));
+    float *C_h = stream.enabled ? malloc_host<float>(C_size,q) : static_cast<float*>(malloc(C_size*sizeof(float)));
 
-    //# define matrix A as the 3x3 matrix
-    //# {{ 1, 2, 3}, {4, 5, 6}, {7, 8, 9}}
-    
-    for(int i=0;i<m*k;i++)
-        A_h[i] = 10.0;
+    for(size_t i=0;i<A_size;i++)
+        A_h[i] = gemm_bench::Value(i, 0, 0);
 
-    for(int i=0;i<k*n;i++)
-        B_h[i] = 20.0;
+    for(size_t i=0;i<B_size;i++)
+        B_h[i] = gemm_bench::Value(i, 0, 1);
 
-    for (int i=0; i<m*n; i++)
+    for (size_t i=0; i<C_size; i++)
         C_h[i] = 0.0;
 
     
@@ -126,66 +104,124 @@ int main(int argc, char *argv[]) {
     //# We must also pass in our list of dependencies as the final parameter.
     //# We are also passing in our USM pointers as opposed to a buffer or raw data pointer.
 
-    auto *A_usm = static_cast<float*>(malloc_device<float>(n*k,q));
-    auto *B_usm = static_cast<float*>(malloc_device<float>(k*m,q));
-    auto *C_usm = static_cast<float*>(malloc_device<float>(n*m,q));
+    //# When streaming the device holds the column-major view's A and one column panel of its
+    //# B and C per pipeline slot
+    const int64_t cols = (cm.n + stream.chunks - 1) / stream.chunks;
+    auto *A_usm = static_cast<float*>(malloc_device<float>(stream.enabled ? cm.SizeA() : A_size,q));
+    auto *B_usm = static_cast<float*>(malloc_device<float>(stream.enabled ? (size_t)cm.ldb()*cols*stream.depth : B_size,q));
+    auto *C_usm = static_cast<float*>(malloc_device<float>(stream.enabled ? (size_t)cm.ldc()*cols*stream.depth : C_size,q));
 
-    Calibrate(&ClkPerSec,NSecClk);
-
-
-    for(int count=0;count<iteration_count;count++)
+    if(stream.enabled)
     {
-        start = rdtsc();
-        auto e1 = q.memcpy(A_usm,A_h,(sizeof(float)*n*k));
-        auto e2 = q.memcpy(B_usm,B_h,(sizeof(float)*k*m));
-        auto e3 = q.memcpy(C_usm,C_h,(sizeof(float)*n*m));
-
-        e1.wait();
-        e2.wait();
-        e3.wait();
-        end1 = rdtsc();
-        gemm_done = mkl::blas::gemm(q, transA, transB, m, n, k, alpha, A_usm, ldA, B_usm, ldB, beta, C_usm, ldC, gemm_dependencies);
-
-        //# We must now wait for the given event to finish before accessing any data involved in the operation
-        //# Otherwise, we may access data before the operation has completed, or before it has been returned to the host
-        gemm_done.wait();
-	end2 = rdtsc();
-        elapsed_count[count] = (double)(end2-start)/ClkPerSec;
-        elapsed_trf[count] = (double)(end1-start)/ClkPerSec;
+        pipeline::Streamer streamer(q, stream, opts.clock);
+        pipeline::Report report;
+        for(int count=0;count<gemm_time.iterations();count++)
+        {
+            //# C(:,j0:j1) = op(A) * B(:,j0:j1) + C(:,j0:j1) in the column-major view, one column
+            //# panel per chunk; a row-major product swaps the roles of A and B
+            const float *A_cm = problem.ColMajor() ? A_h : B_h, *B_cm = problem.ColMajor() ? B_h : A_h;
+            sycl::event A_ready;
+            report = streamer.Run([&](queue &sq, int slot, int c) {
+                auto [j0, j1] = pipeline::Chunk(cm.n, stream.chunks, c);
+                gemm_bench::Problem panel = cm;
+                panel.n = j1 - j0;
+                float *B_slot = B_usm + (size_t)slot*cm.ldb()*cols, *C_slot = C_usm + (size_t)slot*cm.ldc()*cols;
+
+                pipeline::Stage stage;
+                if(c == 0)
+                {
+                    A_ready = sq.memcpy(A_usm,A_cm,sizeof(float)*cm.SizeA());
+                    stage.in.push_back(A_ready);
+                }
+                stage.in.push_back(sq.memcpy(B_slot,B_cm + j0*cm.ldb(),sizeof(float)*panel.SizeB()));
+                stage.in.push_back(sq.memcpy(C_slot,C_h + j0*cm.ldc(),sizeof(float)*panel.SizeC()));
+                stage.compute = {gemm_bench::Gemm(sq, panel, alpha, A_usm, B_slot, beta, C_slot, {A_ready})};
+                stage.out = {sq.memcpy(C_h + j0*cm.ldc(),C_slot,sizeof(float)*panel.SizeC())};
+                return stage;
+            });
+            gemm_time.Record(report.wall);
+            transfer_time.Record(report.copy_in + report.copy_out);
+        }
+        report.Print();
     }
-
-    for(int count=1;count<iteration_count;count++)
+    else
     {
-        Average1 += elapsed_count[count];
-        Average2 += elapsed_trf[count];
+        for(int count=0;count<gemm_time.iterations();count++)
+        {
+            harness::Timer timer(opts.clock);
+            auto e1 = q.memcpy(A_usm,A_h,(sizeof(float)*A_size));
+            auto e2 = q.memcpy(B_usm,B_h,(sizeof(float)*B_size));
+            auto e3 = q.memcpy(C_usm,C_h,(sizeof(float)*C_size));
+
+            e1.wait();
+            e2.wait();
+            e3.wait();
+            transfer_time.Record(timer.Elapsed());
+            gemm_done = gemm_bench::Gemm(q, problem, alpha, A_usm, B_usm, beta, C_usm, gemm_dependencies);
+
+            //# We must now wait for the given event to finish before accessing any data involved in the operation
+            //# Otherwise, we may access data before the operation has completed, or before it has been returned to the host
+            gemm_done.wait();
+            gemm_time.Record(timer.Elapsed());
+        }
     }
 
-    Average1 = Average1/(iteration_count-1);
-    Average2 = Average2/(iteration_count-1);
-    printf("\nTime to compute Matrix Product = %0.12f \nTime to transfer = %0.12f\n",Average1,Average2);
-
-    //int status = 0;
-
-    //# verify C matrix using USM data
-    //std::cout << "\n";
-    //std::cout << "C = \n";
-    //for (int i = 0; i < m; ++i) {
-    //    for (int j = 0; j < n; ++j) {
-    //        if (A_usm[i*m+j] != C_usm[i*m+j]) status = 1;
-    //        std::cout << C_usm[i*m+j] << " ";
-    //    }
-    //    std::cout << "\n";
-    //}
-    //std::cout << "\n";
+    printf("\nTime to compute Matrix Product = %0.12f \nTime to transfer = %0.12f\n",gemm_time.Summary().mean,transfer_time.Summary().mean);
+    gemm_time.Print();
+    transfer_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "gemm";
+    run.variant = stream.enabled ? "dpcpp_gemm_dcopy_stream" : "dpcpp_gemm_dcopy";
+    run.device = my_device.get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp32";
+    run.sizes = gemm_bench::Sizes(problem);
+    run.flops = 2.0 * m * n * k;
+    //# The timed region copies A, B and C to the device before the product
+    double transfer_bytes = (double(m) * k + double(k) * n + double(m) * n) * sizeof(float);
+    if(stream.enabled)
+    {
+        //# Streaming also copies C back
+        transfer_bytes += double(m) * n * sizeof(float);
+        run.sizes.push_back({"chunks", stream.chunks});
+        run.sizes.push_back({"depth", stream.depth});
+    }
+    run.bytes = transfer_bytes + (double(m) * k + double(k) * n + 2.0 * m * n) * sizeof(float);
+    harness::WriteRecords(run, gemm_time);
+
+    run.flops = 0.0;
+    run.bytes = transfer_bytes;
+    harness::WriteRecords(run, transfer_time);
+
+    //# verify C at sampled entries.  Without streaming every pass copies the zero host C to
+    //# the device; streaming copies C back each pass, so the host copy holds one product per pass
+    double scale = 1.0;
+    if(stream.enabled)
+        scale = gemm_time.iterations();
+    else
+        q.memcpy(C_h,C_usm,sizeof(float)*C_size).wait();
+    const double error = gemm_bench::SampledError(problem, A_h, B_h, C_h, scale);
+    const int status = error <= scale * gemm_bench::Tolerance<float>(k) ? 0 : 1;
 
     //# free usm pointers
-    free(A_h);
-    free(B_h);
-    free(C_h);
+    if(stream.enabled)
+    {
+        sycl::free(A_h,q);
+        sycl::free(B_h,q);
+        sycl::free(C_h,q);
+    }
+    else
+    {
+        free(A_h);
+        free(B_h);
+        free(C_h);
+    }
     sycl::free(A_usm,q);
     sycl::free(B_usm,q);
     sycl::free(C_usm,q);
 
-    //status == 0 ? std::cout << "Verified: A = C\n" : std::cout << "Failed: A != C\n";
-    return 0;
+    status == 0 ? std::cout << "Verified: C = A * B (" << problem.Name() << ", max sampled error " << error << ")\n"
+                : std::cout << "Failed: C != A * B (" << problem.Name() << ", max sampled error " << error << ")\n";
+    return status;
 }
@@ -0,0 +1,188 @@
+//==============================================================
+// Copyright © 2023 Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sycl/sycl.hpp>          //# sycl namespace
+#include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
+#include "harness.hpp"
+#include "report.hpp"
+#include "GemmBench.hpp"
+#include "GemmService.hpp"
+
+//# A stream of GEMM requests served by one persistent gemm_service::Executor: one queue,
+//# pooled device memory and oneMKL kernels warmed up by a checked run of every request.
+//# Each timed pass enqueues the whole stream back to back and waits once; the driver
+//# prints the wall time per call next to the device time of the gemms, so the per-call
+//# overhead of the service is their difference.  For comparison the same stream runs
+//# standalone, each call allocating, filling, multiplying, waiting and freeing.
+//#
+//#   dpcpp_gemm_service <iterations> <cpu|gpu> [requests.txt]
+//#
+//# Without a file a built-in mix of sizes, precisions and layouts is served; the file
+//# format is described in GemmService.hpp.
+
+using namespace sycl;
+namespace mkl = oneapi::mkl;  //# shorten mkl namespace
+
+const char *default_requests =
+    "fp32 64 64 64 repeat 64\n"
+    "fp32 256 256 256 repeat 16\n"
+    "fp64 128 96 160 trans nt repeat 16\n"
+    "fp32 512 512 512 layout row repeat 4\n"
+    "fp64 384 384 128 layout row trans tn pad 8 repeat 4\n"
+    "fp32 1024 1024 1024 repeat 2\n";
+
+//# One request the way a standalone driver runs it: own allocations, device fill, gemm, wait, free
+template <class T>
+void Standalone(queue &q, const gemm_bench::Problem &p)
+{
+    T *A = malloc_device<T>(p.SizeA(), q);
+    T *B = malloc_device<T>(p.SizeB(), q);
+    T *C = malloc_device<T>(p.SizeC(), q);
+    if (A == nullptr || B == nullptr || C == nullptr)
+        throw std::runtime_error("out of device memory");
+    event fill_a = gemm_bench::Fill(q, A, p.SizeA(), 0);
+    event fill_b = gemm_bench::Fill(q, B, p.SizeB(), 1);
+    gemm_bench::Gemm(q, p, T(1), A, B, T(0), C, {fill_a, fill_b}).wait_and_throw();
+    sycl::free(A, q);
+    sycl::free(B, q);
+    sycl::free(C, q);
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <iterations> <cpu|gpu> [requests.txt]\n";
+        return 1;
+    }
+    const int iteration_count = atoi(argv[1]);
+
+    std::vector<gemm_service::Request> requests;
+    try {
+        if (argc > 3) {
+            std::ifstream file(argv[3]);
+            if (!file)
+                throw std::invalid_argument(std::string("cannot open ") + argv[3]);
+            requests = gemm_service::ReadRequests(file, argv[3]);
+        } else {
+            std::istringstream text(default_requests);
+            requests = gemm_service::ReadRequests(text, "default requests");
+        }
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    //# Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
+    queue q;
+    if (strcmp(argv[2], "cpu") == 0)
+        q = queue(cpu_selector_v);
+    else
+        q = queue(gpu_selector_v);
+
+    device my_device = q.get_device();
+    std::cout << "Device: " << my_device.get_info<info::device::name>() << "\n";
+
+    if (!my_device.has(aspect::fp64)) {
+        auto fp64 = [](const gemm_service::Request &r) { return r.fp64; };
+        if (std::any_of(requests.begin(), requests.end(), fp64))
+            std::cout << "fp64 requests skipped (device has no fp64)\n";
+        requests.erase(std::remove_if(requests.begin(), requests.end(), fp64), requests.end());
+    }
+    if (requests.empty()) {
+        std::cerr << "No requests to serve\n";
+        return 1;
+    }
+
+    int64_t calls = 0;
+    double flops = 0.0, bytes = 0.0;
+    bool fp32 = false, fp64 = false;
+    for (const auto &r : requests) {
+        const gemm_bench::Problem &p = r.problem;
+        const size_t elem = r.fp64 ? sizeof(double) : sizeof(float);
+        calls += r.repeat;
+        flops += 2.0 * p.m * p.n * p.k * r.repeat;
+        //# A and B written by the fill and read by the gemm, C written
+        bytes += double(2 * (p.SizeA() + p.SizeB()) + p.SizeC()) * elem * r.repeat;
+        (r.fp64 ? fp64 : fp32) = true;
+    }
+
+    gemm_service::Executor service(q);
+
+    //# The checked run of every request also warms up its oneMKL kernel
+    bool ok = true;
+    for (const auto &r : requests) {
+        const double err = service.Check(r);
+        const double tol = r.fp64 ? gemm_bench::Tolerance<double>(r.problem.k) : gemm_bench::Tolerance<float>(r.problem.k);
+        ok = ok && err <= tol;
+        printf("%-40s x%-5d max error %g%s\n", r.Name().c_str(), r.repeat, err, err <= tol ? "" : "  FAILED");
+    }
+
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+
+    harness::Series service_time("dpcpp_gemm_service stream", opts);
+    double gemm_seconds = 0.0;
+    bool gemm_known = true;   //# every timed pass reported its device time
+    for (int count = 0; count < service_time.iterations(); count++) {
+        harness::Timer timer(opts.clock);
+        for (const auto &r : requests)
+            service.Run(r);
+        const double device = service.Wait();
+        service_time.Record(timer.Elapsed());
+        if (count >= opts.warmup) {
+            gemm_known = gemm_known && device >= 0.0;
+            gemm_seconds += device;
+        }
+    }
+
+    harness::Series standalone_time("dpcpp_gemm_service standalone", opts);
+    harness::Run(standalone_time, [&]() {
+        for (const auto &r : requests)
+            for (int i = 0; i < r.repeat; i++)
+                r.fp64 ? Standalone<double>(q, r.problem) : Standalone<float>(q, r.problem);
+    });
+
+    const double service_call = service_time.Summary().median / calls;
+    const double standalone_call = standalone_time.Summary().median / calls;
+    std::cout << "Requests : " << requests.size() << ", " << calls << " calls per pass\n";
+    std::cout << "Pool     : " << service.blocks() << " blocks, " << service.pooled_bytes() << " bytes, "
+              << service.reused() << " draws reused\n";
+    printf("Service    : %10.3f us/call  %8.2f GFLOP/s\n", 1e6 * service_call, 1e-9 * flops / service_time.Summary().median);
+    if (gemm_known) {
+        const double gemm_call = gemm_seconds / opts.repetitions / calls;
+        printf("  gemm     : %10.3f us/call (device), overhead %.3f us/call\n", 1e6 * gemm_call,
+               1e6 * (service_call - gemm_call));
+    } else if (!service.profiled()) {
+        std::cout << "  (device has no queue profiling, gemm time unknown)\n";
+    } else {
+        std::cout << "  (gemm events without profiling data, gemm time unknown)\n";
+    }
+    printf("Standalone : %10.3f us/call  %8.2f GFLOP/s\n", 1e6 * standalone_call,
+           1e-9 * flops / standalone_time.Summary().median);
+    service_time.Print();
+    standalone_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "gemm";
+    run.device = my_device.get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = fp32 && fp64 ? "mixed" : (fp64 ? "fp64" : "fp32");
+    run.sizes = {{"requests", (long long)requests.size()}, {"calls", calls}};
+    run.flops = flops;
+    run.bytes = bytes;
+    run.variant = "dpcpp_gemm_service";
+    harness::WriteRecords(run, service_time);
+    run.variant = "dpcpp_gemm_service_standalone";
+    harness::WriteRecords(run, standalone_time);
+
+    std::cout << (ok ? "Verified: all requests match the host\n" : "Failed: some requests differ from the host\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,320 @@
+//==============================================================
+// Copyright © 2023 Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <sycl/sycl.hpp>          //# sycl namespace
+#include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
+#include "harness.hpp"
+#include "report.hpp"
+#include "GemmBench.hpp"      //# layout, transposes, leading dimensions and the residual check
+#include "../Pipeline.hpp"     //# DeviceSeconds
+
+//# One large GEMM split across several queues instead of one queue's internal threading.
+//# C is cut into column panels of its column-major view (row panels of a row-major C),
+//# one per partition; every partition holds its own copy of A and its panels of B and C,
+//# allocated and filled through its own queue, and runs one gemm per pass.  A pass
+//# submits all partitions and waits for all of them.
+//#
+//#   dpcpp_gemm_split <iterations> <cpu|gpu|numa|cpu+gpu> n m k [layout row|col]
+//#       [trans nn|nt|tn|tt] [pad <elements>] [split static|proportional] [queues <per device>]
+//#
+//#   cpu, gpu   the first CPU or GPU device
+//#   numa       the CPU's NUMA domains as sub-devices (any other affinity partition if the
+//#              runtime has no NUMA partition, the whole CPU if it cannot be partitioned)
+//#   cpu+gpu    the CPU and every GPU and accelerator
+//#
+//# `queues` puts that many partitions on every device (default 1).  The static split gives
+//# every partition the same number of columns; the proportional split first times each
+//# partition alone on its static panel and gives it columns in proportion to its throughput.
+//# The driver prints the device time of every partition when the devices support queue
+//# profiling, then checks C at sampled entries against a host product.
+
+using namespace sycl;
+namespace mkl = oneapi::mkl;  //# shorten mkl namespace
+
+struct Partition {
+    queue q;
+    std::string name;
+    int64_t j0 = 0, j1 = 0;   //# columns of C in the column-major view
+    float *A = nullptr, *B = nullptr, *C = nullptr;
+    event done;
+};
+
+//# Devices of the run; numa falls back as described above
+std::vector<device> Devices(const std::string &which)
+{
+    if (which == "cpu")
+        return {device(cpu_selector_v)};
+    if (which == "gpu")
+        return {device(gpu_selector_v)};
+    if (which == "numa") {
+        device cpu(cpu_selector_v);
+        for (auto domain : {info::partition_affinity_domain::numa, info::partition_affinity_domain::next_partitionable}) {
+            try {
+                auto sub = cpu.create_sub_devices<info::partition_property::partition_by_affinity_domain>(domain);
+                if (!sub.empty())
+                    return sub;
+            } catch (const sycl::exception &) {
+                //# the runtime does not support this partition
+            }
+        }
+        std::cout << "numa: the CPU device cannot be partitioned, using it whole\n";
+        return {cpu};
+    }
+    if (which == "cpu+gpu") {
+        std::vector<device> devices = {device(cpu_selector_v)};
+        for (auto type : {info::device_type::gpu, info::device_type::accelerator})
+            for (const auto &d : device::get_devices(type))
+                devices.push_back(d);
+        if (devices.size() == 1)
+            std::cout << "cpu+gpu: no GPU or accelerator found, using the CPU alone\n";
+        return devices;
+    }
+    throw std::invalid_argument("device is cpu, gpu, numa or cpu+gpu");
+}
+
+//# Column boundaries: partition p gets columns in proportion to weights[p], at least one each
+std::vector<int64_t> Boundaries(int64_t n, const std::vector<double> &weights)
+{
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    const int64_t parts = (int64_t)weights.size();
+    std::vector<int64_t> bounds = {0};
+    double sum = 0.0;
+    for (int64_t p = 0; p < parts; p++) {
+        sum += weights[p];
+        int64_t end = p + 1 == parts ? n : (int64_t)(n * sum / total + 0.5);
+        end = std::max(end, bounds.back() + 1);
+        end = std::min(end, n - (parts - 1 - p));
+        bounds.push_back(end);
+    }
+    return bounds;
+}
+
+//# The panel of partition p as a column-major problem of its own
+gemm_bench::Problem Panel(const gemm_bench::Problem &cm, const Partition &p)
+{
+    gemm_bench::Problem panel = cm;
+    panel.n = p.j1 - p.j0;
+    return panel;
+}
+
+void Release(Partition &p)
+{
+    if (p.A) sycl::free(p.A, p.q);
+    if (p.B) sycl::free(p.B, p.q);
+    if (p.C) sycl::free(p.C, p.q);
+    p.A = p.B = p.C = nullptr;
+}
+
+//# Allocates the partition's A and panels of B and C on its queue and copies A and B in
+void Place(Partition &p, const gemm_bench::Problem &cm, const float *A_cm, const float *B_cm)
+{
+    Release(p);
+    const gemm_bench::Problem panel = Panel(cm, p);
+    p.A = malloc_device<float>(cm.SizeA(), p.q);
+    p.B = malloc_device<float>(panel.SizeB(), p.q);
+    p.C = malloc_device<float>(panel.SizeC(), p.q);
+    if (p.A == nullptr || p.B == nullptr || p.C == nullptr)
+        throw std::runtime_error("out of device memory on " + p.name);
+    p.q.memcpy(p.A, A_cm, sizeof(float) * cm.SizeA());
+    p.q.memcpy(p.B, B_cm + p.j0 * cm.ldb(), sizeof(float) * panel.SizeB());
+    p.q.wait_and_throw();
+}
+
+event Submit(Partition &p, const gemm_bench::Problem &cm)
+{
+    p.done = gemm_bench::Gemm(p.q, Panel(cm, p), 1.0f, p.A, p.B, 0.0f, p.C, {});
+    return p.done;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 6) {
+        std::cerr << "Usage: " << argv[0] << " <iterations> <cpu|gpu|numa|cpu+gpu> n m k [layout row|col]\n"
+                  << "       [trans nn|nt|tn|tt] [pad <elements>] [split static|proportional] [queues <per device>]\n";
+        return 1;
+    }
+    const int iteration_count = atoi(argv[1]);
+    const int n = atoi(argv[3]);
+    const int m = atoi(argv[4]);
+    const int k = atoi(argv[5]);
+
+    //# The panels are contiguous column panels of B and C in the column-major view
+    gemm_bench::Problem problem{m, n, k};
+    std::string split = "static";
+    int queues_per_device = 1;
+    std::vector<device> devices;
+    try {
+        problem.StorageFromArgs(argc, argv, 6);
+        problem.Validate(sizeof(float));
+        if (gemm_bench::Problem::Trans(problem.ColumnMajor().transb))
+            throw std::invalid_argument("split needs contiguous panels: trans nn or tn (col), nn or nt (row)");
+        for (int i = 6; i + 1 < argc; i++) {
+            if (strcmp(argv[i], "split") == 0) {
+                split = argv[++i];
+                if (split != "static" && split != "proportional")
+                    throw std::invalid_argument("split is static or proportional");
+            } else if (strcmp(argv[i], "queues") == 0) {
+                queues_per_device = atoi(argv[++i]);
+                if (queues_per_device < 1)
+                    throw std::invalid_argument("queues needs a positive count");
+            }
+        }
+        devices = Devices(argv[2]);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    const gemm_bench::Problem cm = problem.ColumnMajor();
+
+    std::vector<Partition> parts;
+    bool profiled = true;
+    for (size_t d = 0; d < devices.size(); d++) {
+        const bool profiling = devices[d].has(aspect::queue_profiling);
+        profiled = profiled && profiling;
+        for (int i = 0; i < queues_per_device; i++) {
+            parts.push_back({profiling ? queue(devices[d], property_list{property::queue::enable_profiling()})
+                                       : queue(devices[d]),
+                             "[" + std::to_string(d) + "." + std::to_string(i) + "] " +
+                                 devices[d].get_info<info::device::name>()});
+        }
+    }
+    if ((int64_t)parts.size() > cm.n) {
+        std::cerr << parts.size() << " partitions for " << cm.n << " columns\n";
+        return 1;
+    }
+    for (const auto &p : parts)
+        std::cout << "Partition " << p.name << "\n";
+
+    //# Host operands for the copies and the check; a row-major product swaps A and B in the view
+    std::vector<float> A_h(problem.SizeA()), B_h(problem.SizeB()), C_h(problem.SizeC());
+    for (size_t i = 0; i < A_h.size(); i++)
+        A_h[i] = gemm_bench::Value(i, 0, 0);
+    for (size_t i = 0; i < B_h.size(); i++)
+        B_h[i] = gemm_bench::Value(i, 0, 1);
+    const float *A_cm = problem.ColMajor() ? A_h.data() : B_h.data();
+    const float *B_cm = problem.ColMajor() ? B_h.data() : A_h.data();
+
+    auto assign = [&](const std::vector<double> &weights) {
+        std::vector<int64_t> bounds = Boundaries(cm.n, weights);
+        for (size_t i = 0; i < parts.size(); i++) {
+            parts[i].j0 = bounds[i];
+            parts[i].j1 = bounds[i + 1];
+            Place(parts[i], cm, A_cm, B_cm);
+        }
+    };
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+    try {
+        assign(std::vector<double>(parts.size(), 1.0));
+        if (split == "proportional") {
+            //# Columns per second of every partition alone on its static panel, after a warmup call
+            std::vector<double> weights;
+            for (auto &p : parts) {
+                Submit(p, cm).wait_and_throw();
+                harness::Timer timer(opts.clock);
+                Submit(p, cm).wait_and_throw();
+                const double seconds = timer.Elapsed();
+                weights.push_back((p.j1 - p.j0) / std::max(seconds, 1e-9));
+                printf("Calibration %-40s %8lld columns %12.6f s\n", p.name.c_str(), (long long)(p.j1 - p.j0), seconds);
+            }
+            assign(weights);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        for (auto &p : parts) Release(p);
+        return 1;
+    }
+
+    harness::Series gemm_time("dpcpp_gemm_split " + split + " " + problem.Name(), opts);
+    std::vector<harness::Series> part_time;
+    for (const auto &p : parts)
+        part_time.emplace_back("dpcpp_gemm_split " + p.name, opts);
+    bool timed = profiled;   //# every pass has the device time of every partition
+
+    for (int count = 0; count < gemm_time.iterations(); count++) {
+        harness::Timer timer(opts.clock);
+        for (auto &p : parts)
+            Submit(p, cm);
+        for (auto &p : parts)
+            p.done.wait_and_throw();
+        gemm_time.Record(timer.Elapsed());
+        //# oneMKL may return events without profiling data; then no partition series is kept
+        std::vector<double> part_seconds(parts.size());
+        for (size_t i = 0; timed && i < parts.size(); i++)
+            timed = pipeline::DeviceSeconds(parts[i].done, part_seconds[i]);
+        if (timed)
+            for (size_t i = 0; i < parts.size(); i++)
+                part_time[i].Record(part_seconds[i]);
+    }
+
+    const double seconds = gemm_time.Summary().median;
+    printf("\n%s split over %zu partitions: %0.6f s, %0.2f GFLOP/s\n", split.c_str(), parts.size(), seconds,
+           2e-9 * m * n * k / seconds);
+    gemm_time.Print();
+    if (timed) {
+        //# The slowest partition bounds the pass; imbalance is its time over the mean
+        double slowest = 0.0, mean = 0.0;
+        for (size_t i = 0; i < parts.size(); i++) {
+            const double t = part_time[i].Summary().median;
+            const int64_t columns = parts[i].j1 - parts[i].j0;
+            printf("  %-40s columns %8lld-%-8lld %12.6f s %10.2f GFLOP/s\n", parts[i].name.c_str(),
+                   (long long)parts[i].j0, (long long)parts[i].j1, t, t > 0.0 ? 2e-9 * cm.m * columns * cm.k / t : 0.0);
+            slowest = std::max(slowest, t);
+            mean += t / parts.size();
+        }
+        printf("  imbalance (slowest / mean) %.3f\n", mean > 0.0 ? slowest / mean : 0.0);
+        for (auto &s : part_time)
+            s.Print();
+    } else if (!profiled) {
+        std::cout << "  (a device has no queue profiling, partition times unknown)\n";
+    } else {
+        std::cout << "  (gemm events without profiling data, partition times unknown)\n";
+    }
+
+    harness::RunInfo run;
+    run.kernel = "gemm";
+    run.variant = "dpcpp_gemm_split_" + split;
+    for (const auto &d : devices)
+        run.device += (run.device.empty() ? "" : " + ") + d.get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp32";
+    run.sizes = gemm_bench::Sizes(problem);
+    run.sizes.push_back({"partitions", (long long)parts.size()});
+    run.flops = 2.0 * m * n * k;
+    //# Every partition reads A and its panel of B and writes its panel of C
+    run.bytes = (double(m) * k * parts.size() + double(k) * n + double(m) * n) * sizeof(float);
+    harness::WriteRecords(run, gemm_time);
+    if (timed) {
+        for (size_t i = 0; i < parts.size(); i++) {
+            const int64_t columns = parts[i].j1 - parts[i].j0;
+            harness::RunInfo part = run;
+            part.variant = "dpcpp_gemm_split_" + split + "_partition";
+            part.device = parts[i].q.get_device().get_info<info::device::name>();
+            part.sizes.push_back({"partition", (long long)i});
+            part.sizes.push_back({"columns", columns});
+            part.flops = 2.0 * cm.m * columns * cm.k;
+            part.bytes = (double(cm.m) * cm.k + double(cm.k) * columns + double(cm.m) * columns) * sizeof(float);
+            harness::WriteRecords(part, part_time[i]);
+        }
+    }
+
+    //# Gather the panels of C (beta = 0, so one product) and verify at sampled entries
+    for (auto &p : parts) {
+        const gemm_bench::Problem panel = Panel(cm, p);
+        p.q.memcpy(C_h.data() + p.j0 * cm.ldc(), p.C, sizeof(float) * panel.SizeC()).wait();
+        Release(p);
+    }
+    const double error = gemm_bench::SampledError(problem, A_h.data(), B_h.data(), C_h.data());
+    const int status = error <= gemm_bench::Tolerance<float>(k) ? 0 : 1;
+
+    status == 0 ? std::cout << "Verified: C = A * B (" << problem.Name() << ", max sampled error " << error << ")\n"
+                : std::cout << "Failed: C != A * B (" << problem.Name() << ", max sampled error " << error << ")\n";
+    return status;
+}
@@ -4,57 +4,31 @@
 // SPDX-License-Identifier: MIT
 // =============================================================
 #include <iostream>
+#include <string>
 #include <vector>
 #include <sycl/sycl.hpp>          //# sycl namespace
 #include "oneapi/mkl/blas.hpp"  //# oneMKL DPC++ interface for BLAS functions
-#include <sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
+#include "GemmBench.hpp"  //# layout, transposes, leading dimensions and the residual check
 
 // # The following project performs matrix multiplication using oneMKL / DPC++ with Unified Shared Memory (USM)
 // # We will execute the simple operation A * B = C
-// # The matrix B is set equal to the identity matrix such that A * B = A * I
-// # After performing the computation, we will verify A * I = C -> A = C
+// # A and B are filled on the device with the repeating pattern of gemm_bench::Value (GemmBench.hpp)
+// # The storage is set by trailing "layout row|col", "trans nn|nt|tn|tt" and "pad <elements>"
+// # arguments (default column-major, no transposes, no padding)
+// # After the timed passes, gemm_bench::SampledError compares C with a double-precision host
+// # product at its four corners and 256 pseudo-random entries; the exit status reports the result
+// # A, B and C are initialized once by fill kernels, outside the timed loop, in shared USM
+// # ("memory shared", the default) or device USM ("memory device").  The main timing is the
+// # gemm on resident data.  With shared USM a second, migration-inclusive timing has the
+// # host rewrite the matrices between passes, so the timed gemm also pays for moving the
+// # pages back to the device; "prefetch" adds prefetches of A, B and C to that timed region
+// # and "advise <n>" applies a backend-specific mem_advise value to A and B
 
 using namespace sycl;
 namespace mkl = oneapi::mkl;  //# shorten mkl namespace
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc, char *argv[]) {
 
     //# dimensions
@@ -68,25 +42,43 @@ int main(int argc, char *argv[]) {
     const int m = atoi(argv[4]);
     const int k = atoi(argv[5]);
 
-    int ldA = m, ldB = k, ldC = m;
+    //# Leading dimensions and sizes follow from the layout, the transposes and the padding
+    gemm_bench::Problem problem{m, n, k};
+    bool device_memory = false, prefetch = false;
+    int advice = -1;
+    try {
+        problem.StorageFromArgs(argc, argv, 6);
+        problem.Validate(sizeof(double));
+        for (int i = 6; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "memory" && i + 1 < argc) {
+                const std::string value = argv[++i];
+                if (value != "shared" && value != "device")
+                    throw std::invalid_argument("memory is shared or device");
+                device_memory = value == "device";
+            } else if (arg == "prefetch") {
+                prefetch = true;
+            } else if (arg == "advise" && i + 1 < argc) {
+                advice = atoi(argv[++i]);
+            }
+        }
+        if (device_memory && (prefetch || advice >= 0))
+            throw std::invalid_argument("prefetch and advise apply to memory shared");
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
 
-    queue cpu_queue(cpu_selector_v);
-    queue gpu_queue(gpu_selector_v);
+    //# Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
     queue q;
     if (strcmp(argv[2], "cpu") == 0)
-        q = cpu_queue;
+        q = queue(cpu_selector_v);
     else
-        q = gpu_queue;
+        q = queue(gpu_selector_v);
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[10];
-    double Average = 0.0;
-    
-    //# transpose status of matrices
-    mkl::transpose transA = mkl::transpose::nontrans;
-    mkl::transpose transB = mkl::transpose::nontrans;
+    harness::Options opts = harness::Options::FromEnv(iteration_count);
+    harness::Series gemm_time("dpcpp_gemm_usm " + problem.Name(), opts);
+    harness::Series migration_time("dpcpp_gemm_usm " + problem.Name() + (prefetch ? " migration prefetch" : " migration"), opts);
 
     //### Step 1 - Create a queue with default selector.
     //queue q;
@@ -100,82 +92,123 @@ int main(int argc, char *argv[]) {
     sycl::event gemm_done;
     std::vector<sycl::event> gemm_dependencies;
     
-    //# Here, we allocate USM pointers for each matrix, using the special 'malloc_shared' function
+    //# Here, we allocate USM pointers for each matrix, with 'malloc_shared' or 'malloc_device'
     //# Make sure to template the function with the correct precision, and pass in our queue to the function call
     
-    //float *A_usm = sycl::malloc_shared<float>(m * k, q);
-    double *A_usm = static_cast<double*>(malloc_shared(m*k*sizeof(double),q));
-    double *B_usm = static_cast<double*>(malloc_shared(k*n*sizeof(double),q));
-    double *C_usm = static_cast<double*>(malloc_shared(m*n*sizeof(double),q));
-    //float *B_usm = sycl::malloc_shared<float>(k * n, q);
-    //float *C_usm = sycl::malloc_shared<float>(m * n, q);
-
-
-/*    for(int i=0;i<m*k;i++)
-        A_usm[i] = 10.0;
-
-    for(int i=0;i<k*n;i++)
-        B_usm[i] = 20.0;
-
-    for (int i=0; i<m*n; i++)
-        C_usm[i] = 0.0;*/
+    const usm::alloc kind = device_memory ? usm::alloc::device : usm::alloc::shared;
+    const size_t A_bytes = problem.SizeA()*sizeof(double), B_bytes = problem.SizeB()*sizeof(double),
+                 C_bytes = problem.SizeC()*sizeof(double);
+    double *A_usm = static_cast<double*>(sycl::malloc(A_bytes,q,kind));
+    double *B_usm = static_cast<double*>(sycl::malloc(B_bytes,q,kind));
+    double *C_usm = static_cast<double*>(sycl::malloc(C_bytes,q,kind));
+
+    if (advice >= 0)
+    {
+        q.mem_advise(A_usm,A_bytes,advice);
+        q.mem_advise(B_usm,B_bytes,advice);
+    }
 
-    //# define matrix A as the 3x3 matrix
-    //# {{ 1, 2, 3}, {4, 5, 6}, {7, 8, 9}}
+    //# Initialize once on the device; for shared USM the first touch also places the pages there
+    gemm_bench::Fill(q, A_usm, problem.SizeA(), 0);
+    gemm_bench::Fill(q, B_usm, problem.SizeB(), 1);
+    q.fill(C_usm, 0.0, problem.SizeC());
+    q.wait();
     
     //### Step 3 - Execute gemm operation.
     //# Here, we fill in the familiar parameters for the gemm operation.
     //# However, we must also pass in the queue as the first parameter.
     //# We must also pass in our list of dependencies as the final parameter.
     //# We are also passing in our USM pointers as opposed to a buffer or raw data pointer.
-    Calibrate(&ClkPerSec,NSecClk);
-
-    for(int count=0;count<iteration_count;count++)
+    //# Pure compute: the data stays where it is; beta = 1, so C gains one product per pass
+    for(int count=0;count<gemm_time.iterations();count++)
     {
-        for(int i=0;i<m*k;i++)
-            A_usm[i] = 10.0;
-
-        for(int i=0;i<k*n;i++)
-            B_usm[i] = 20.0;
-
-        for (int i=0; i<m*n; i++)
-            C_usm[i] = 0.0;
-        //printf("Starting Loop!\n");
-        start = rdtsc(); 
-        gemm_done = mkl::blas::gemm(q, transA, transB, m, n, k, alpha, A_usm, ldA, B_usm, ldB, beta, C_usm, ldC, gemm_dependencies);
+        harness::Timer timer(opts.clock);
+        gemm_done = gemm_bench::Gemm(q, problem, alpha, A_usm, B_usm, beta, C_usm, gemm_dependencies);
         //# We must now wait for the given event to finish before accessing any data involved in the operation
         //# Otherwise, we may access data before the operation has completed, or before it has been returned to the host
         gemm_done.wait();
-	end = rdtsc();
-        elapsed_count[count] = (double)(end-start)/ClkPerSec;
-        printf("TTC : %0.12f\n",elapsed_count[count]);
+        double ttc = timer.Elapsed();
+        gemm_time.Record(ttc);
+        printf("TTC : %0.12f\n",ttc);
     }
 
-    for(int count=1;count<iteration_count;count++)
-        Average += elapsed_count[count];
+    double passes = gemm_time.iterations();
+    if (!device_memory)
+    {
+        //# Migration-inclusive: the host rewrites A, B and C (untimed), which moves their pages
+        //# to the host, and the timed gemm has to bring them back
+        for(int count=0;count<migration_time.iterations();count++)
+        {
+            for(size_t i=0;i<problem.SizeA();i++)
+                A_usm[i] = gemm_bench::Value(i, 0, 0);
+
+            for(size_t i=0;i<problem.SizeB();i++)
+                B_usm[i] = gemm_bench::Value(i, 0, 1);
+
+            for (size_t i=0; i<problem.SizeC(); i++)
+                C_usm[i] = 0.0;
+
+            harness::Timer timer(opts.clock);
+            std::vector<sycl::event> migrated = gemm_dependencies;
+            if (prefetch)
+                migrated = {q.prefetch(A_usm,A_bytes), q.prefetch(B_usm,B_bytes), q.prefetch(C_usm,C_bytes)};
+            gemm_bench::Gemm(q, problem, alpha, A_usm, B_usm, beta, C_usm, migrated).wait();
+            migration_time.Record(timer.Elapsed());
+        }
+        passes = 1;
+    }
 
-    Average = Average/(iteration_count - 1);
-    printf("\nTime to compute Matrix Product = %0.12f \n",Average);
+    printf("\nTime to compute Matrix Product = %0.12f \n",gemm_time.Summary().mean);
+    gemm_time.Print();
+    if (!device_memory)
+    {
+        printf("Time with page migration%s = %0.12f (resident %0.12f)\n", prefetch ? " and prefetch" : "",
+               migration_time.Summary().mean, gemm_time.Summary().mean);
+        migration_time.Print();
+    }
 
-    //int status = 0;
+    harness::RunInfo run;
+    run.kernel = "gemm";
+    run.variant = "dpcpp_gemm_usm";
+    run.device = my_device.get_info<info::device::name>();
+    run.memory = device_memory ? "usm_device" : "usm_shared";
+    run.precision = "fp64";
+    run.sizes = gemm_bench::Sizes(problem);
+    run.flops = 2.0 * m * n * k;
+    //# A and B are read once, C is read and written (beta = 1)
+    run.bytes = (double(m) * k + double(k) * n + 2.0 * m * n) * sizeof(double);
+    harness::WriteRecords(run, gemm_time);
+    if (!device_memory)
+    {
+        run.variant = prefetch ? "dpcpp_gemm_usm_migration_prefetch" : "dpcpp_gemm_usm_migration";
+        harness::WriteRecords(run, migration_time);
+    }
 
-    //# verify C matrix using USM data
-    //std::cout << "\n";
-    //std::cout << "C = \n";
-    //for (int i = 0; i < m; ++i) {
-    //    for (int j = 0; j < n; ++j) {
-    //        if (A_usm[i*m+j] != C_usm[i*m+j]) status = 1;
-    //        std::cout << C_usm[i*m+j] << " ";
-    //    }
-    //    std::cout << "\n";
-    //}
-    //std::cout << "\n";
+    //# verify C matrix using USM data: C = passes * A * B at sampled entries (device data is copied back first)
+    std::vector<double> A_h, B_h, C_h;
+    const double *A_check = A_usm, *B_check = B_usm, *C_check = C_usm;
+    if (device_memory)
+    {
+        A_h.resize(problem.SizeA());
+        B_h.resize(problem.SizeB());
+        C_h.resize(problem.SizeC());
+        q.memcpy(A_h.data(),A_usm,A_bytes);
+        q.memcpy(B_h.data(),B_usm,B_bytes);
+        q.memcpy(C_h.data(),C_usm,C_bytes);
+        q.wait();
+        A_check = A_h.data();
+        B_check = B_h.data();
+        C_check = C_h.data();
+    }
+    const double error = gemm_bench::SampledError(problem, A_check, B_check, C_check, passes);
+    const int status = error <= passes * gemm_bench::Tolerance<double>(k) ? 0 : 1;
 
     //# free usm pointers
     sycl::free(A_usm, q);
     sycl::free(B_usm, q);
     sycl::free(C_usm, q);
 
-    //status == 0 ? std::cout << "Verified: A = C\n" : std::cout << "Failed: A != C\n";
-    return 0;
+    status == 0 ? std::cout << "Verified: C = A * B (" << problem.Name() << ", max sampled error " << error << ")\n"
+                : std::cout << "Failed: C != A * B (" << problem.Name() << ", max sampled error " << error << ")\n";
+    return status;
 }
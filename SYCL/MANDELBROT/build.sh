@@ -1,9 +1,6 @@
 #!/bin/bash
 #source /opt/intel/inteloneapi/setvars.sh
+# Mandelbrot is part of the top-level CMake project
 rm -rf build
-build="$PWD/build"
-[ ! -d "$build" ] && mkdir -p "$build"
-cd build &&
-cmake .. &&
-cmake --build . &&
-make run
+cmake -S ../.. -B build -DCMAKE_CXX_COMPILER=icpx -DENABLE_MKL=OFF &&
+cmake --build build --target run
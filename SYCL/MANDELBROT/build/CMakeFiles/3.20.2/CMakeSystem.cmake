@@ -1,15 +0,0 @@
-set(CMAKE_HOST_SYSTEM "Linux-5.14.0-284.25.1.el9_2.x86_64")
-set(CMAKE_HOST_SYSTEM_NAME "Linux")
-set(CMAKE_HOST_SYSTEM_VERSION "5.14.0-284.25.1.el9_2.x86_64")
-set(CMAKE_HOST_SYSTEM_PROCESSOR "x86_64")
-
-
-
-set(CMAKE_SYSTEM "Linux-5.14.0-284.25.1.el9_2.x86_64")
-set(CMAKE_SYSTEM_NAME "Linux")
-set(CMAKE_SYSTEM_VERSION "5.14.0-284.25.1.el9_2.x86_64")
-set(CMAKE_SYSTEM_PROCESSOR "x86_64")
-
-set(CMAKE_CROSSCOMPILING "FALSE")
-
-set(CMAKE_SYSTEM_LOADED 1)
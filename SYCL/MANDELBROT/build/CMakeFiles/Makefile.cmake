@@ -1,124 +0,0 @@
-# CMAKE generated file: DO NOT EDIT!
-# Generated by "Unix Makefiles" Generator, CMake Version 3.20
-
-# The generator used is:
-set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
-
-# The top level Makefile was generated from the following files:
-set(CMAKE_MAKEFILE_DEPENDS
-  "CMakeCache.txt"
-  "../CMakeLists.txt"
-  "CMakeFiles/3.20.2/CMakeCCompiler.cmake"
-  "CMakeFiles/3.20.2/CMakeCXXCompiler.cmake"
-  "CMakeFiles/3.20.2/CMakeSystem.cmake"
-  "/usr/share/cmake/Modules/CMakeCCompiler.cmake.in"
-  "/usr/share/cmake/Modules/CMakeCCompilerABI.c"
-  "/usr/share/cmake/Modules/CMakeCInformation.cmake"
-  "/usr/share/cmake/Modules/CMakeCXXCompiler.cmake.in"
-  "/usr/share/cmake/Modules/CMakeCXXCompilerABI.cpp"
-  "/usr/share/cmake/Modules/CMakeCXXInformation.cmake"
-  "/usr/share/cmake/Modules/CMakeCommonLanguageInclude.cmake"
-  "/usr/share/cmake/Modules/CMakeCompilerIdDetection.cmake"
-  "/usr/share/cmake/Modules/CMakeDetermineCCompiler.cmake"
-  "/usr/share/cmake/Modules/CMakeDetermineCXXCompiler.cmake"
-  "/usr/share/cmake/Modules/CMakeDetermineCompileFeatures.cmake"
-  "/usr/share/cmake/Modules/CMakeDetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/CMakeDetermineCompilerABI.cmake"
-  "/usr/share/cmake/Modules/CMakeDetermineCompilerId.cmake"
-  "/usr/share/cmake/Modules/CMakeDetermineSystem.cmake"
-  "/usr/share/cmake/Modules/CMakeFindBinUtils.cmake"
-  "/usr/share/cmake/Modules/CMakeGenericSystem.cmake"
-  "/usr/share/cmake/Modules/CMakeInitializeConfigs.cmake"
-  "/usr/share/cmake/Modules/CMakeLanguageInformation.cmake"
-  "/usr/share/cmake/Modules/CMakeParseImplicitIncludeInfo.cmake"
-  "/usr/share/cmake/Modules/CMakeParseImplicitLinkInfo.cmake"
-  "/usr/share/cmake/Modules/CMakeParseLibraryArchitecture.cmake"
-  "/usr/share/cmake/Modules/CMakeSystem.cmake.in"
-  "/usr/share/cmake/Modules/CMakeSystemSpecificInformation.cmake"
-  "/usr/share/cmake/Modules/CMakeSystemSpecificInitialize.cmake"
-  "/usr/share/cmake/Modules/CMakeTestCCompiler.cmake"
-  "/usr/share/cmake/Modules/CMakeTestCXXCompiler.cmake"
-  "/usr/share/cmake/Modules/CMakeTestCompilerCommon.cmake"
-  "/usr/share/cmake/Modules/CMakeUnixFindMake.cmake"
-  "/usr/share/cmake/Modules/Compiler/ADSP-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/ARMCC-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/ARMClang-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/AppleClang-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Borland-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Bruce-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
-  "/usr/share/cmake/Modules/Compiler/Clang-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Clang-DetermineCompilerInternal.cmake"
-  "/usr/share/cmake/Modules/Compiler/Comeau-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Compaq-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Compaq-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Cray-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Embarcadero-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Fujitsu-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/GHS-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/GNU-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/GNU-C.cmake"
-  "/usr/share/cmake/Modules/Compiler/GNU-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/GNU-FindBinUtils.cmake"
-  "/usr/share/cmake/Modules/Compiler/GNU.cmake"
-  "/usr/share/cmake/Modules/Compiler/HP-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/HP-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/IAR-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/IBMCPP-C-DetermineVersionInternal.cmake"
-  "/usr/share/cmake/Modules/Compiler/IBMCPP-CXX-DetermineVersionInternal.cmake"
-  "/usr/share/cmake/Modules/Compiler/Intel-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/IntelLLVM-CXX.cmake"
-  "/usr/share/cmake/Modules/Compiler/IntelLLVM-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/IntelLLVM.cmake"
-  "/usr/share/cmake/Modules/Compiler/MSVC-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/NVHPC-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/NVIDIA-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/OpenWatcom-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/PGI-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/PathScale-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/SCO-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/SDCC-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/SunPro-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/SunPro-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/TI-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/TinyCC-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/VisualAge-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/VisualAge-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/Watcom-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/XL-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/XL-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/XLClang-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/XLClang-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/zOS-C-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Compiler/zOS-CXX-DetermineCompiler.cmake"
-  "/usr/share/cmake/Modules/Internal/FeatureTesting.cmake"
-  "/usr/share/cmake/Modules/Platform/Linux-Determine-CXX.cmake"
-  "/usr/share/cmake/Modules/Platform/Linux-GNU-C.cmake"
-  "/usr/share/cmake/Modules/Platform/Linux-GNU.cmake"
-  "/usr/share/cmake/Modules/Platform/Linux-IntelLLVM-CXX.cmake"
-  "/usr/share/cmake/Modules/Platform/Linux-IntelLLVM.cmake"
-  "/usr/share/cmake/Modules/Platform/Linux.cmake"
-  "/usr/share/cmake/Modules/Platform/UnixPaths.cmake"
-  )
-
-# The corresponding makefile is:
-set(CMAKE_MAKEFILE_OUTPUTS
-  "Makefile"
-  "CMakeFiles/cmake.check_cache"
-  )
-
-# Byproducts of CMake generate step:
-set(CMAKE_MAKEFILE_PRODUCTS
-  "CMakeFiles/3.20.2/CMakeSystem.cmake"
-  "CMakeFiles/3.20.2/CMakeCCompiler.cmake"
-  "CMakeFiles/3.20.2/CMakeCXXCompiler.cmake"
-  "CMakeFiles/3.20.2/CMakeCCompiler.cmake"
-  "CMakeFiles/3.20.2/CMakeCXXCompiler.cmake"
-  "CMakeFiles/CMakeDirectoryInformation.cmake"
-  )
-
-# Dependency information for all targets:
-set(CMAKE_DEPEND_INFO_FILES
-  "CMakeFiles/run.dir/DependInfo.cmake"
-  "CMakeFiles/mandelbrot.dir/DependInfo.cmake"
-  )
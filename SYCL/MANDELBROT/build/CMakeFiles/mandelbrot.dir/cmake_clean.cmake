@@ -1,11 +0,0 @@
-file(REMOVE_RECURSE
-  "CMakeFiles/mandelbrot.dir/src/main.cpp.o"
-  "CMakeFiles/mandelbrot.dir/src/main.cpp.o.d"
-  "mandelbrot"
-  "mandelbrot.pdb"
-)
-
-# Per-language clean rules from dependency scanning.
-foreach(lang CXX)
-  include(CMakeFiles/mandelbrot.dir/cmake_clean_${lang}.cmake OPTIONAL)
-endforeach()
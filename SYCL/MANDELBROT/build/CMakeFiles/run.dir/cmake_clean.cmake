@@ -1,8 +0,0 @@
-file(REMOVE_RECURSE
-  "CMakeFiles/run"
-)
-
-# Per-language clean rules from dependency scanning.
-foreach(lang )
-  include(CMakeFiles/run.dir/cmake_clean_${lang}.cmake OPTIONAL)
-endforeach()
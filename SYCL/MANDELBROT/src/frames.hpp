@@ -0,0 +1,148 @@
+//==============================================================
+// Frame-sequence rendering for zoom animations.
+//
+// MandelFrames keeps one in-order queue and `depth` image slots, each a
+// device allocation and a pinned host copy, alive for the whole sequence,
+// so a frame costs a kernel, a copy and the file write, not a process with
+// its own queue, JIT and blocking PNG write.  Before the host waits for
+// frame i, frame i + depth - 1 is enqueued (kernel, then copy into its
+// host slot), so the device computes ahead while the host threads
+// colour-map and encode.  The new frame takes the slot of frame i - 1,
+// which has been written by then.
+//
+// The queue is created with profiling when the device supports it;
+// Render() returns the wall time, the summed device time and the summed
+// host encode time, from which the achieved overlap is reported.
+// =============================================================
+
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "harness.hpp"
+#include "mandel.hpp"
+
+struct MandelFrameReport {
+  int frames = 0;
+  double wall = 0.0;    // first submit to the last file written
+  double device = 0.0;  // summed kernel and copy-back time
+  double encode = 0.0;  // summed host colour mapping and encoding
+  bool profiled = false;
+
+  double Fps() const { return wall > 0.0 ? frames / wall : 0.0; }
+
+  // Fraction of the serialized device + encode time hidden by the pipeline.
+  double Overlap() const {
+    const double serial = device + encode;
+    return (profiled && serial > 0.0) ? std::max(0.0, 1.0 - wall / serial) : 0.0;
+  }
+
+  void Print(std::ostream &out = std::cout) const {
+    out << "Frames : " << frames << " in " << wall << " s, " << Fps() << " frames/s, encode " << encode << " s";
+    if (profiled)
+      out << ", device " << device << " s, overlap " << 100.0 * Overlap() << "%\n";
+    else
+      out << " (device has no queue profiling, overlap unknown)\n";
+  }
+};
+
+class MandelFrames {
+ public:
+  MandelFrames(const queue &q, int row_count, int col_count, int depth = 2)
+      : rows_(row_count), cols_(col_count), depth_(std::max(1, depth)),
+        profiled_(q.get_device().has(aspect::queue_profiling)),
+        q_(q.get_context(), q.get_device(),
+           profiled_ ? property_list{property::queue::in_order(), property::queue::enable_profiling()}
+                     : property_list{property::queue::in_order()}) {
+    const size_t pixels = (size_t)rows_ * cols_;
+    for (int s = 0; s < depth_; ++s) {
+      device_.push_back(malloc_device<int>(pixels, q_));
+      host_.push_back(malloc_host<int>(pixels, q_));
+      if (device_.back() == nullptr || host_.back() == nullptr) {
+        Free();
+        throw std::runtime_error("MandelFrames: allocating the frame slots failed");
+      }
+    }
+    events_.resize(depth_);
+  }
+
+  ~MandelFrames() { Free(); }
+
+  MandelFrames(const MandelFrames &) = delete;
+  MandelFrames &operator=(const MandelFrames &) = delete;
+
+  int depth() const { return depth_; }
+
+  // Host copy of frame `frame` of the last Render, valid until the slot is
+  // reused; the last `depth` frames are still there.
+  const int *Frame(int frame) const { return host_[frame % depth_]; }
+
+  // Renders views[i] with max_iterations into file name(i) for every i.
+  template <class Name>
+  MandelFrameReport Render(const std::vector<MandelView> &views, int max_iterations, Name name,
+                           harness::ClockKind clock = harness::ClockKind::steady) {
+    const int frames = (int)views.size();
+    MandelFrameReport report;
+    report.frames = frames;
+    report.profiled = profiled_;
+
+    harness::Timer wall(clock);
+    for (int f = 0; f < std::min(depth_, frames); ++f) Submit(f, views[f], max_iterations);
+    for (int f = 0; f < frames; ++f) {
+      // The slot of frame f - 1 is free again: keep depth frames in flight
+      if (f > 0 && f + depth_ - 1 < frames) Submit(f + depth_ - 1, views[f + depth_ - 1], max_iterations);
+
+      const int slot = f % depth_;
+      events_[slot].second.wait_and_throw();
+      if (profiled_) report.device += Seconds(events_[slot].first) + Seconds(events_[slot].second);
+
+      harness::Timer encode(clock);
+      MandelWriteImage(name(f), host_[slot], rows_, cols_);
+      report.encode += encode.Elapsed();
+    }
+    report.wall = wall.Elapsed();
+    return report;
+  }
+
+ private:
+  // Kernel of frame `frame` into its device slot, then the copy to its host slot.
+  void Submit(int frame, const MandelView &view, int max_iterations) {
+    const int slot = frame % depth_;
+    const MandelParameters p(rows_, cols_, max_iterations, view);
+    const int cols = cols_;
+    int *out = device_[slot];
+    event kernel = q_.parallel_for(range<2>(rows_, cols_), [=](id<2> index) {
+      int i = int(index[0]);
+      int j = int(index[1]);
+      auto c = MandelParameters::ComplexF(p.ScaleRow(i), p.ScaleCol(j));
+      out[(size_t)i * cols + j] = p.Point(c);
+    });
+    event copy = q_.memcpy(host_[slot], out, sizeof(int) * (size_t)rows_ * cols_, kernel);
+    events_[slot] = {kernel, copy};
+  }
+
+  static double Seconds(event &e) {
+    return 1e-9 * (e.get_profiling_info<info::event_profiling::command_end>() -
+                   e.get_profiling_info<info::event_profiling::command_start>());
+  }
+
+  void Free() {
+    for (int *d : device_)
+      if (d != nullptr) free(d, q_);
+    for (int *h : host_)
+      if (h != nullptr) free(h, q_);
+    device_.clear();
+    host_.clear();
+  }
+
+  int rows_, cols_, depth_;
+  bool profiled_;
+  queue q_;
+  std::vector<int *> device_, host_;
+  std::vector<std::pair<event, event>> events_;  // kernel and copy of the frame in each slot
+};
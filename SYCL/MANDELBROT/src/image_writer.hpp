@@ -0,0 +1,249 @@
+//==============================================================
+// Strip-wise RGB image output for Mandel::writeImage.
+//
+// The image is produced in strips of rows by a caller-supplied fill
+// function.  A batch of strips (one per thread) is filled, and for PNG
+// filtered and deflated, in parallel; the batch is then written in order
+// and its buffers are reused, so memory stays at threads x strip instead
+// of a full RGB copy of the image.
+//
+// The format follows the file extension:
+//   .ppm  binary PPM (P6), raw bytes
+//   .png  PNG.  With zlib (MANDEL_HAVE_ZLIB) every strip is compressed on
+//         its own thread as a raw deflate stream ended by a sync flush, so
+//         the strips concatenate into one valid stream (as pigz does).
+//         Without zlib the strips are stored uncompressed.
+// The zlib checksum of the whole image is combined from the per-strip
+// checksums.
+// =============================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef MANDEL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace image_writer {
+
+constexpr uint32_t adler_base = 65521;
+
+inline uint32_t Adler32(uint32_t adler, const uint8_t *data, size_t len) {
+  uint32_t a = adler & 0xffff, b = adler >> 16;
+  while (len > 0) {
+    // 5552 bytes keep b below 2^32 between reductions
+    const size_t n = std::min<size_t>(len, 5552);
+    for (size_t i = 0; i < n; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= adler_base;
+    b %= adler_base;
+    data += n;
+    len -= n;
+  }
+  return a | (b << 16);
+}
+
+// Checksum of A followed by B from the checksums of both and the length of B.
+inline uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, size_t len2) {
+  const uint32_t rem = (uint32_t)(len2 % adler_base);
+  uint32_t sum1 = adler1 & 0xffff;
+  uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % adler_base);
+  sum1 += (adler2 & 0xffff) + adler_base - 1;
+  sum2 += (adler1 >> 16) + (adler2 >> 16) + adler_base - rem;
+  if (sum1 >= adler_base) sum1 -= adler_base;
+  if (sum1 >= adler_base) sum1 -= adler_base;
+  if (sum2 >= 2 * adler_base) sum2 -= 2 * adler_base;
+  if (sum2 >= adler_base) sum2 -= adler_base;
+  return sum1 | (sum2 << 16);
+}
+
+inline uint32_t Crc32(uint32_t crc, const uint8_t *data, size_t len) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      t[n] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+// Raw deflate blocks of one strip, not final, ending on a byte boundary.
+inline void Deflate(const std::vector<uint8_t> &in, std::vector<uint8_t> &out) {
+  out.clear();
+#ifdef MANDEL_HAVE_ZLIB
+  z_stream zs = {};
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    throw std::runtime_error("deflateInit2 failed");
+  out.resize(deflateBound(&zs, in.size()) + 16);
+  zs.next_in = const_cast<Bytef *>(in.data());
+  zs.avail_in = (uInt)in.size();
+  zs.next_out = out.data();
+  zs.avail_out = (uInt)out.size();
+  int status;
+  for (;;) {
+    status = deflate(&zs, Z_SYNC_FLUSH);
+    if (status != Z_OK || zs.avail_out != 0) break;  // a full buffer may hold back part of the flush
+    const size_t used = out.size();
+    out.resize(2 * used);
+    zs.next_out = out.data() + used;
+    zs.avail_out = (uInt)used;
+  }
+  const size_t produced = out.size() - zs.avail_out;
+  deflateEnd(&zs);
+  if (status != Z_OK || zs.avail_in != 0) throw std::runtime_error("deflate failed");
+  out.resize(produced);
+#else
+  // Stored blocks of at most 65535 bytes
+  for (size_t pos = 0; pos < in.size(); pos += 65535) {
+    const uint16_t len = (uint16_t)std::min<size_t>(65535, in.size() - pos);
+    const uint8_t header[5] = {0x00, (uint8_t)len, (uint8_t)(len >> 8), (uint8_t)~len, (uint8_t)(~len >> 8)};
+    out.insert(out.end(), header, header + 5);
+    out.insert(out.end(), in.begin() + pos, in.begin() + pos + len);
+  }
+#endif
+}
+
+class File {
+ public:
+  explicit File(const std::string &name) : f_(std::fopen(name.c_str(), "wb")), name_(name) {
+    if (!f_) throw std::runtime_error("cannot open " + name);
+  }
+  ~File() {
+    if (f_) std::fclose(f_);
+  }
+
+  void Write(const void *data, size_t len) {
+    if (len > 0 && std::fwrite(data, 1, len, f_) != len) throw std::runtime_error("write to " + name_ + " failed");
+  }
+
+  // One PNG chunk: length, type, data, CRC of type and data
+  void Chunk(const char *type, const uint8_t *data, size_t len) {
+    const uint8_t length[4] = {(uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len};
+    uint32_t crc = Crc32(0, reinterpret_cast<const uint8_t *>(type), 4);
+    crc = Crc32(crc, data, len);
+    const uint8_t tail[4] = {(uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+    Write(length, 4);
+    Write(type, 4);
+    Write(data, len);
+    Write(tail, 4);
+  }
+
+  void Close() {
+    FILE *f = f_;
+    f_ = nullptr;
+    if (std::fclose(f) != 0) throw std::runtime_error("closing " + name_ + " failed");
+  }
+
+ private:
+  FILE *f_;
+  std::string name_;
+};
+
+// Writes a width x height RGB8 image.  fill(y0, y1, rgb) stores rows
+// [y0, y1) into rgb, width * 3 bytes per row; it is called concurrently
+// for disjoint strips.  threads = 0 uses std::thread::hardware_concurrency().
+template <class Fill>
+void WriteRGB(const std::string &file_name, int width, int height, Fill fill, int strip_rows = 64, int threads = 0) {
+  const bool png = file_name.size() >= 4 && file_name.compare(file_name.size() - 4, 4, ".png") == 0;
+  const bool ppm = file_name.size() >= 4 && file_name.compare(file_name.size() - 4, 4, ".ppm") == 0;
+  if (!png && !ppm) throw std::invalid_argument("image file must end in .png or .ppm: " + file_name);
+  if (width <= 0 || height <= 0) throw std::invalid_argument("empty image");
+
+  strip_rows = std::max(1, strip_rows);
+  threads = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+  const size_t row_bytes = (size_t)width * 3;
+  const int strips = (height + strip_rows - 1) / strip_rows;
+  threads = std::min(threads, strips);
+
+  File file(file_name);
+  if (png) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    const uint8_t ihdr[13] = {(uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+                              (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+                              8, 2, 0, 0, 0};  // 8 bits, RGB, deflate, adaptive filtering, no interlace
+    static const uint8_t zlib_header[2] = {0x78, 0x01};
+    file.Write(signature, 8);
+    file.Chunk("IHDR", ihdr, 13);
+    file.Chunk("IDAT", zlib_header, 2);
+  } else {
+    const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    file.Write(header.data(), header.size());
+  }
+
+  // Per-thread strip: the raw rows (PNG: each led by filter type 0) and the deflated bytes
+  std::vector<std::vector<uint8_t>> raw(threads), packed(threads);
+  std::vector<uint32_t> adler(threads);
+  uint32_t total_adler = 1;
+
+  for (int first = 0; first < strips; first += threads) {
+    const int batch = std::min(threads, strips - first);
+    auto work = [&](int t) {
+      const int y0 = (first + t) * strip_rows, y1 = std::min(height, y0 + strip_rows);
+      std::vector<uint8_t> &buf = raw[t];
+      if (!png) {
+        buf.resize((y1 - y0) * row_bytes);
+        fill(y0, y1, buf.data());
+        return;
+      }
+      std::vector<uint8_t> &rgb = packed[t];
+      rgb.resize((y1 - y0) * row_bytes);
+      fill(y0, y1, rgb.data());
+      buf.resize((y1 - y0) * (row_bytes + 1));
+      for (int y = 0; y < y1 - y0; ++y) {
+        buf[y * (row_bytes + 1)] = 0;
+        std::copy(rgb.begin() + y * row_bytes, rgb.begin() + (y + 1) * row_bytes, buf.begin() + y * (row_bytes + 1) + 1);
+      }
+      adler[t] = Adler32(1, buf.data(), buf.size());
+      Deflate(buf, packed[t]);
+    };
+    // An exception must not leave a worker (terminate) or skip the joins; the first one is rethrown here
+    std::vector<std::exception_ptr> errors(batch);
+    auto guarded = [&](int t) {
+      try {
+        work(t);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < batch; ++t) pool.emplace_back(guarded, t);
+    guarded(0);
+    for (auto &th : pool) th.join();
+    for (auto &e : errors)
+      if (e) std::rethrow_exception(e);
+
+    for (int t = 0; t < batch; ++t) {
+      if (png) {
+        file.Chunk("IDAT", packed[t].data(), packed[t].size());
+        total_adler = Adler32Combine(total_adler, adler[t], raw[t].size());
+      } else {
+        file.Write(raw[t].data(), raw[t].size());
+      }
+    }
+  }
+
+  if (png) {
+    // Final empty stored block, then the checksum of the filtered rows
+    const uint8_t tail[9] = {0x01, 0x00, 0x00, 0xff, 0xff, (uint8_t)(total_adler >> 24), (uint8_t)(total_adler >> 16),
+                             (uint8_t)(total_adler >> 8), (uint8_t)total_adler};
+    file.Chunk("IDAT", tail, 9);
+    file.Chunk("IEND", nullptr, 0);
+  }
+  file.Close();
+}
+
+}  // namespace image_writer
@@ -5,13 +5,25 @@
 // SPDX-License-Identifier: MIT
 // =============================================================
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
 #include <CL/sycl.hpp>
 
 #include "dpc_common.hpp"
+#include "frames.hpp"
+#include "harness.hpp"
 #include "mandel.hpp"
+#include "perturbation.hpp"
+#include "report.hpp"
 
 using namespace std;
 using namespace cl::sycl;
@@ -31,47 +43,421 @@ void ShowDevice(queue &q) {
   cout << std::setw(20) << "Max Compute Units: " << max_compute_units << "\n";
 }
 
-void Execute(queue &q) {
-  // Demonstrate the Mandelbrot calculation serial and parallel
-  MandelParallel m_par(row_size, col_size, max_iterations);
-  MandelSerial m_ser(row_size, col_size, max_iterations);
+// The host engine takes seconds per pass at full size, so it gets fewer passes
+constexpr int host_repetitions = 3;
+// A frame sequence pass writes every frame, so it gets few passes too
+constexpr int frame_repetitions = 3;
 
-  // Run the code once to trigger JIT
-  m_par.Evaluate(q);
+// Command line of the driver; every field has a default.
+struct Settings {
+  int rows = row_size;  // along the real axis (image width)
+  int cols = col_size;  // along the imaginary axis (image height)
+  int max_iterations = ::max_iterations;
+  int repetitions = ::repetitions;
+  MandelDeepView view;  // center kept as text for the perturbation engine
+  MandelTileConfig tiles;
+  string batch;  // file of viewports, empty for the single view above
+  bool perturbation = false;
+  int frames = 0;         // zoom sequence length, 0 for no sequence
+  int frame_depth = 2;    // frames in flight in the sequence
+  double zoom_end = 0.0;  // zoom of the last frame, 0 for 1000 x zoom
+};
+
+// One viewport of a run: a view and its iteration cap.
+struct Viewport {
+  MandelDeepView view;
+  int max_iterations;
+};
+
+// Sizes recorded with every series of one viewport.
+vector<pair<string, long long>> ViewSizes(const Mandel &m, int index) {
+  MandelParameters p = m.GetParameters();
+  // Sizes are integers; deep zooms are recorded as their decimal exponent too
+  const double zoom = m.GetView().zoom;
+  return {{"rows", p.row_count()}, {"cols", p.col_count()}, {"max_iterations", p.max_iterations()},
+          {"zoom", std::llround(std::min(zoom, 1e18))}, {"zoom_log10", std::llround(std::log10(zoom))},
+          {"view", index}};
+}
+
+// Times one schedule of the multithreaded host engine and prints its load balance.
+void TimeHost(MandelThreaded &m, MandelThreaded::Schedule schedule, const char *name, int index, int reps) {
+  harness::Options opts = harness::Options::FromEnv(std::min(reps, host_repetitions));
+  harness::Series host_time(name, opts);
+  for (int i = 0; i < host_time.iterations(); ++i) {
+    harness::Timer timer(opts.clock);
+    m.Evaluate(schedule);
+    host_time.Record(timer.Elapsed());
+  }
+  host_time.Print();
+  m.PrintLoad();
+
+  MandelParameters p = m.GetParameters();
+  harness::RunInfo run;
+  run.kernel = "mandelbrot";
+  run.variant = schedule == MandelThreaded::Schedule::static_rows ? "host_static_rows" : "host_dynamic_tiles";
+  run.device = "host (" + std::to_string(m.threads()) + " threads, " + std::to_string(MandelSimd::lanes) + " lanes)";
+  run.memory = "host";
+  run.precision = "fp32";
+  run.sizes = ViewSizes(m, index);
+  run.sizes.insert(run.sizes.end(), {{"threads", m.threads()}, {"tile", m.tile()}});
+  run.bytes = (double)p.row_count() * p.col_count() * sizeof(int);
+  harness::WriteRecords(run, host_time);
+}
 
-  // Run the parallel version
-  dpc_common::MyTimer t_par;
-  // time the parallel computation
-  for (int i = 0; i < repetitions; ++i) 
+// Renders one viewport with every engine; m_par and m_host are already set to it.
+void Execute(queue &q, MandelParallel &m_par, MandelThreaded &m_host, const Settings &settings, int index,
+             const string &image_name) {
+  // Demonstrate the Mandelbrot calculation parallel, validated against the
+  // multithreaded SIMD host engine (same counts as MandelSerial)
+  const MandelTileConfig &tile_cfg = settings.tiles;
+  MandelParameters p = m_par.GetParameters();
+  MandelView view = m_par.GetView();
+  cout << "View " << index << ": center (" << std::setprecision(17) << view.center_real << ", "
+       << view.center_imag << "), zoom " << view.zoom << std::setprecision(6) << ", " << p.row_count()
+       << "x" << p.col_count() << ", " << p.max_iterations() << " iterations\n";
+
+  // Time the parallel version; the warmup passes also trigger JIT
+  harness::Options opts = harness::Options::FromEnv(settings.repetitions);
+  harness::Series parallel_time("mandelbrot parallel", opts);
+  for (int i = 0; i < parallel_time.iterations(); ++i) {
+    harness::Timer timer(opts.clock);
     m_par.Evaluate(q);
-  dpc_common::Duration parallel_time = t_par.elapsed();
+    parallel_time.Record(timer.Elapsed());
+  }
 
   // Print the results
   m_par.Print();
-  m_par.writeImage();
-  // Run the serial version
-  dpc_common::MyTimer t_ser;
-  m_ser.Evaluate();
-  dpc_common::Duration serial_time = t_ser.elapsed();
+  harness::Timer image_timer(opts.clock);
+  m_par.writeImage(image_name);
+  cout << "Image " << image_name << " written in " << image_timer.Elapsed() << " s\n";
+  // Run the host engine with static row bands, then with work-stealing tiles
+  cout << "Host engine: " << m_host.threads() << " threads, " << MandelSimd::lanes << " lanes, "
+       << m_host.tile() << "x" << m_host.tile() << " tiles\n";
+  TimeHost(m_host, MandelThreaded::Schedule::static_rows, "mandelbrot host static rows", index, settings.repetitions);
+  TimeHost(m_host, MandelThreaded::Schedule::dynamic_tiles, "mandelbrot host dynamic tiles", index, settings.repetitions);
 
   // Report the results
-  cout << std::setw(20) << "serial time: " << serial_time.count() << "s\n";
-  cout << std::setw(20) << "parallel time: " << (parallel_time / repetitions).count() << "s\n";
+  cout << std::setw(20) << "parallel time: " << parallel_time.Summary().mean << "s\n";
+  parallel_time.Print();
+
+  harness::RunInfo run;
+  run.kernel = "mandelbrot";
+  run.variant = "buffer";
+  run.device = q.get_device().get_info<info::device::name>();
+  run.memory = "buffer";
+  run.precision = "fp32";
+  run.sizes = ViewSizes(m_par, index);
+  // Iteration counts are data dependent, so only the output write is counted
+  run.bytes = (double)p.row_count() * p.col_count() * sizeof(int);
+  harness::WriteRecords(run, parallel_time);
 
   // Validating
-  m_par.Verify(m_ser);
+  harness::Timer verify_timer(opts.clock);
+  m_par.Verify(m_host);
+  cout << "Verified in " << verify_timer.Elapsed() << " s\n";
+
+  // USM variant: device-resident image, copied back once for the check
+  harness::Series usm_time("mandelbrot usm", opts);
+  for (int i = 0; i < usm_time.iterations(); ++i) {
+    harness::Timer timer(opts.clock);
+    m_par.EvaluateUsm(q);
+    usm_time.Record(timer.Elapsed());
+  }
+  harness::Timer copy_timer(opts.clock);
+  m_par.SyncHost();
+  const double copy_back = copy_timer.Elapsed();
+  usm_time.Print();
+  cout << "buffer " << parallel_time.Summary().mean << " s, usm " << usm_time.Summary().mean
+       << " s (kernel only), usm copy-back " << copy_back << " s\n";
+
+  run.variant = "usm";
+  run.memory = "usm_device";
+  harness::WriteRecords(run, usm_time);
+  run.memory = "buffer";
+
+  m_par.Verify(m_host);
+
+  // Load-balanced variant: persistent work-groups pulling tiles off a counter
+  harness::Series tiles_time("mandelbrot tiles", opts);
+  for (int i = 0; i < tiles_time.iterations(); ++i) {
+    harness::Timer timer(opts.clock);
+    m_par.EvaluateTiles(q, tile_cfg);
+    tiles_time.Record(timer.Elapsed());
+  }
+  cout << "Tiles " << tile_cfg.tile_rows << "x" << tile_cfg.tile_cols << ", work-group "
+       << tile_cfg.group_rows << "x" << tile_cfg.group_cols << ":\n";
+  tiles_time.Print();
+  m_par.PrintTileStats();
+
+  run.variant = "tiles";
+  run.sizes.insert(run.sizes.end(), {{"tile_rows", tile_cfg.tile_rows}, {"tile_cols", tile_cfg.tile_cols},
+                                     {"group_rows", tile_cfg.group_rows}, {"group_cols", tile_cfg.group_cols},
+                                     {"groups", tile_cfg.groups}});
+  harness::WriteRecords(run, tiles_time);
+
+  m_par.Verify(m_host);
+
+  // Adaptive (Mariani-Silver) variants: only rectangle borders are iterated
+  const double pixels = (double)p.row_count() * p.col_count();
+  harness::Series adaptive_time("mandelbrot adaptive", opts);
+  for (int i = 0; i < adaptive_time.iterations(); ++i) {
+    harness::Timer timer(opts.clock);
+    m_par.EvaluateAdaptive(q);
+    adaptive_time.Record(timer.Elapsed());
+  }
+  cout << "Adaptive: iterated " << 100.0 * m_par.Evaluated() / pixels << "% of the pixels\n";
+  adaptive_time.Print();
+
+  run.variant = "adaptive";
+  run.sizes = ViewSizes(m_par, index);
+  harness::WriteRecords(run, adaptive_time);
+
+  m_par.Verify(m_host);
+
+  // The host check compares against a full device image
+  m_par.Evaluate(q);
+  harness::Options host_opts = harness::Options::FromEnv(std::min(settings.repetitions, host_repetitions));
+  harness::Series host_adaptive_time("mandelbrot host adaptive", host_opts);
+  for (int i = 0; i < host_adaptive_time.iterations(); ++i) {
+    harness::Timer timer(host_opts.clock);
+    m_host.EvaluateAdaptive();
+    host_adaptive_time.Record(timer.Elapsed());
+  }
+  cout << "Host adaptive: iterated " << 100.0 * m_host.Evaluated() / pixels << "% of the pixels\n";
+  host_adaptive_time.Print();
+  m_host.PrintLoad();
+
+  run.variant = "host_adaptive";
+  run.device = "host (" + std::to_string(m_host.threads()) + " threads, " + std::to_string(MandelSimd::lanes) + " lanes)";
+  run.memory = "host";
+  harness::WriteRecords(run, host_adaptive_time);
+
+  m_host.Verify(m_par);
+}
+
+// Deep-zoom body: the perturbation engine on the device, checked against
+// the same iteration on the host.
+void ExecuteDeep(queue &q, MandelPerturbation &m_deep, MandelPerturbation &m_check, const Settings &settings,
+                 int index, const string &image_name) {
+  MandelParameters p = m_deep.GetParameters();
+  const MandelDeepView &view = m_deep.GetDeepView();
+  cout << "View " << index << ": center (" << view.center_real << ", " << view.center_imag << "), zoom "
+       << view.zoom << ", " << p.row_count() << "x" << p.col_count() << ", " << p.max_iterations() << " iterations\n";
+
+  harness::Options opts = harness::Options::FromEnv(settings.repetitions);
+  harness::Series deep_time("mandelbrot perturbation", opts);
+  for (int i = 0; i < deep_time.iterations(); ++i) {
+    harness::Timer timer(opts.clock);
+    m_deep.Evaluate(q);
+    deep_time.Record(timer.Elapsed());
+  }
+  cout << "Reference orbit: " << m_deep.ReferenceLength() << " points, " << m_deep.PrecisionBits()
+       << " fraction bits; offsets in " << (m_deep.DeviceDouble() ? "double" : "float") << ", "
+       << 100.0 * m_deep.Rebased() / ((double)p.row_count() * p.col_count()) << "% of the pixels rebased\n";
+  deep_time.Print();
+
+  m_deep.Print();
+  m_deep.writeImage(image_name);
+
+  harness::RunInfo run;
+  run.kernel = "mandelbrot";
+  run.variant = "perturbation";
+  run.device = q.get_device().get_info<info::device::name>();
+  run.memory = "buffer";
+  run.precision = m_deep.DeviceDouble() ? "fp64" : "fp32";
+  run.sizes = ViewSizes(m_deep, index);
+  run.bytes = (double)p.row_count() * p.col_count() * sizeof(int);
+  harness::WriteRecords(run, deep_time);
+
+  harness::Timer host_timer(opts.clock);
+  m_check.EvaluateHost();
+  cout << "Host perturbation (double): " << host_timer.Elapsed() << " s\n";
+  m_deep.Verify(m_check);
+}
+
+// Zoom sequence: settings.frames images at the center, the zoom growing
+// geometrically from settings.view.zoom to settings.zoom_end, rendered by
+// MandelFrames with device compute overlapping the image writes.
+void ExecuteFrames(queue &q, const Settings &settings) {
+  const MandelView start = settings.view.Approximate();
+  const double zoom_end = settings.zoom_end > 0 ? settings.zoom_end : 1000.0 * start.zoom;
+  vector<MandelView> views(settings.frames, start);
+  for (int f = 0; f < settings.frames; ++f)
+    views[f].zoom = start.zoom * std::pow(zoom_end / start.zoom, settings.frames > 1 ? (double)f / (settings.frames - 1) : 0.0);
+
+  cout << "Sequence: " << settings.frames << " frames, center (" << std::setprecision(17) << start.center_real
+       << ", " << start.center_imag << "), zoom " << start.zoom << " to " << zoom_end << std::setprecision(6) << ", "
+       << settings.rows << "x" << settings.cols << ", " << settings.max_iterations << " iterations, "
+       << settings.frame_depth << " frames in flight\n";
+
+  MandelFrames sequence(q, settings.rows, settings.cols, settings.frame_depth);
+  auto frame_name = [](int f) {
+    std::ostringstream name;
+    name << "frame_" << std::setw(5) << std::setfill('0') << f << ".png";
+    return name.str();
+  };
+
+  // One pass renders and writes the whole sequence; the warmup pass takes the JIT
+  harness::Options opts = harness::Options::FromEnv(std::min(settings.repetitions, frame_repetitions));
+  harness::Series frames_time("mandelbrot frames", opts);
+  MandelFrameReport report;
+  for (int i = 0; i < frames_time.iterations(); ++i) {
+    report = sequence.Render(views, settings.max_iterations, frame_name, opts.clock);
+    frames_time.Record(report.wall);
+  }
+  report.Print();
+  frames_time.Print();
+  cout << "Sustained: " << settings.frames / frames_time.Summary().median << " frames/s\n";
+
+  harness::RunInfo run;
+  run.kernel = "mandelbrot";
+  run.variant = "frames";
+  run.device = q.get_device().get_info<info::device::name>();
+  run.memory = "usm_device";
+  run.precision = "fp32";
+  run.sizes = {{"rows", settings.rows}, {"cols", settings.cols}, {"max_iterations", settings.max_iterations},
+               {"frames", settings.frames}, {"depth", sequence.depth()},
+               {"zoom_log10", std::llround(std::log10(zoom_end))}};
+  run.bytes = (double)settings.frames * settings.rows * settings.cols * sizeof(int);
+  harness::WriteRecords(run, frames_time);
+
+  // The last frame is still in its host slot: check it against the host engine
+  MandelParallel m_last(settings.rows, settings.cols, settings.max_iterations, views.back());
+  const int *last = sequence.Frame(settings.frames - 1);
+  std::copy(last, last + (size_t)settings.rows * settings.cols, m_last.data());
+  MandelThreaded m_host(settings.rows, settings.cols, settings.max_iterations, 0, 64, views.back());
+  m_host.Evaluate(MandelThreaded::Schedule::dynamic_tiles);
+  m_last.Verify(m_host);
+}
+
+// Parses "a,b,..." into numbers.
+vector<double> ParseNumbers(const string &value, const string &flag) {
+  vector<double> numbers;
+  std::stringstream ss(value);
+  string item;
+  while (std::getline(ss, item, ',')) {
+    char *end = nullptr;
+    numbers.push_back(std::strtod(item.c_str(), &end));
+    if (item.empty() || *end != '\0') throw std::invalid_argument("bad value '" + value + "' for " + flag);
+  }
+  return numbers;
+}
+
+// Image edges above this are rejected: 131072^2 pixels are already 64 GiB of counts.
+constexpr int max_edge = 1 << 17;
+
+// Parses one integer in [1, max]; the range check comes before any conversion to int.
+int ParsePositive(const string &value, const string &flag, int max = std::numeric_limits<int>::max()) {
+  vector<double> n = ParseNumbers(value, flag);
+  if (n.size() != 1 || !(n[0] >= 1 && n[0] <= max) || n[0] != std::floor(n[0]))
+    throw std::invalid_argument(flag + " needs an integer in [1, " + std::to_string(max) + "]");
+  return (int)n[0];
+}
+
+Settings ParseSettings(int argc, char *argv[]) {
+  Settings settings;
+  for (int i = 1; i < argc; i++) {
+    string flag = argv[i];
+    if (i + 1 >= argc) throw std::invalid_argument("missing value for " + flag);
+    string value = argv[++i];
+
+    if (flag == "--width")
+      settings.rows = ParsePositive(value, flag, max_edge);
+    else if (flag == "--height")
+      settings.cols = ParsePositive(value, flag, max_edge);
+    else if (flag == "--iterations")
+      settings.max_iterations = ParsePositive(value, flag);
+    else if (flag == "--repetitions")
+      settings.repetitions = ParsePositive(value, flag);
+    else if (flag == "--center") {
+      if (ParseNumbers(value, flag).size() != 2) throw std::invalid_argument("--center needs real,imag");
+      settings.view.center_real = value.substr(0, value.find(','));
+      settings.view.center_imag = value.substr(value.find(',') + 1);
+    } else if (flag == "--zoom") {
+      vector<double> z = ParseNumbers(value, flag);
+      if (z.size() != 1 || !(z[0] > 0)) throw std::invalid_argument("--zoom needs a positive number");
+      settings.view.zoom = z[0];
+    } else if (flag == "--tiles") {
+      // tile_rows,tile_cols,group_rows,group_cols[,groups]; groups = 0 picks 4 per compute unit
+      vector<double> t = ParseNumbers(value, flag);
+      if ((t.size() != 4 && t.size() != 5) ||
+          std::find_if(t.begin(), t.end(), [](double x) { return !(x >= 0 && x <= max_edge); }) != t.end())
+        throw std::invalid_argument("--tiles needs 4 or 5 values in [0, " + std::to_string(max_edge) + "]");
+      settings.tiles.tile_rows = (int)t[0];
+      settings.tiles.tile_cols = (int)t[1];
+      settings.tiles.group_rows = (int)t[2];
+      settings.tiles.group_cols = (int)t[3];
+      if (t.size() == 5) settings.tiles.groups = (int)t[4];
+    } else if (flag == "--frames") {
+      // frames[,depth]
+      vector<double> n = ParseNumbers(value, flag);
+      if ((n.size() != 1 && n.size() != 2) || std::find_if(n.begin(), n.end(), [](double x) { return !(x >= 1 && x <= std::numeric_limits<int>::max()) || x != std::floor(x); }) != n.end())
+        throw std::invalid_argument("--frames needs frames[,depth] as positive integers");
+      settings.frames = (int)n[0];
+      if (n.size() == 2) settings.frame_depth = (int)n[1];
+    } else if (flag == "--zoom-end") {
+      vector<double> z = ParseNumbers(value, flag);
+      if (z.size() != 1 || !(z[0] > 0)) throw std::invalid_argument("--zoom-end needs a positive number");
+      settings.zoom_end = z[0];
+    } else if (flag == "--batch")
+      settings.batch = value;
+    else if (flag == "--engine") {
+      if (value != "default" && value != "perturbation") throw std::invalid_argument("--engine is default or perturbation");
+      settings.perturbation = value == "perturbation";
+    }
+    else
+      throw std::invalid_argument("unknown option " + flag);
+  }
+  if (settings.frames > 0 && (settings.perturbation || !settings.batch.empty()))
+    throw std::invalid_argument("--frames renders one zoom sequence, without --batch or --engine perturbation");
+  return settings;
+}
+
+// One viewport per line: center_real center_imag zoom [max_iterations].
+// Blank lines and lines starting with '#' are skipped.
+vector<Viewport> ReadBatch(const string &file_name, int default_iterations) {
+  std::ifstream in(file_name);
+  if (!in) throw std::invalid_argument("cannot open batch file " + file_name);
+  vector<Viewport> views;
+  string line;
+  for (int number = 1; std::getline(in, line); number++) {
+    const size_t first = line.find_first_not_of(" \t\r");
+    if (first == string::npos || line[first] == '#') continue;
+    std::istringstream fields(line);
+    Viewport v{MandelDeepView(), default_iterations};
+    if (!(fields >> v.view.center_real >> v.view.center_imag >> v.view.zoom) || !(v.view.zoom > 0) ||
+        ParseNumbers(v.view.center_real + "," + v.view.center_imag, "center").size() != 2)
+      throw std::invalid_argument(file_name + ":" + std::to_string(number) + ": expected center_real center_imag zoom [iterations]");
+    if (fields >> v.max_iterations && v.max_iterations < 1)
+      throw std::invalid_argument(file_name + ":" + std::to_string(number) + ": iterations must be positive");
+    views.push_back(v);
+  }
+  if (views.empty()) throw std::invalid_argument("no viewports in " + file_name);
+  return views;
 }
 
 void Usage(string program_name) {
   // Utility function to display argument usage
   cout << " Incorrect parameters\n";
   cout << " Usage: ";
-  cout << program_name << "\n\n";
+  cout << program_name << " [--width W] [--height H] [--center real,imag] [--zoom Z]\n"
+       << "        [--iterations N] [--repetitions R] [--batch file] [--engine default|perturbation]\n"
+       << "        [--frames N[,depth] [--zoom-end Z]]\n"
+       << "        [--tiles tile_rows,tile_cols,group_rows,group_cols[,groups]]\n\n";
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 1) {
+  Settings settings;
+  vector<Viewport> views;
+  try {
+    settings = ParseSettings(argc, argv);
+    if (settings.batch.empty())
+      views.push_back({settings.view, settings.max_iterations});
+    else
+      views = ReadBatch(settings.batch, settings.max_iterations);
+  } catch (const std::invalid_argument &e) {
+    cout << " " << e.what() << "\n";
     Usage(argv[0]);
   }
 
@@ -80,13 +466,36 @@ int main(int argc, char *argv[]) {
     // Create a queue using default device
     // Set the SYCL_DEVICE_FILTER, we are using PI_OPENCL environment variable
       
-    // Default queue, set accelerator choice above.
-    //queue q (default_selector{},dpc_common::exception_handler);
-    queue q(gpu_selector_v,dpc_common::exception_handler);
+    // Default queue: the GPU when there is one, otherwise the CPU device
+    queue q(default_selector_v,dpc_common::exception_handler);
     // Display the device info
     ShowDevice(q);
-    // launch the body of the application
-    Execute(q);
+
+    auto image_name = [&](size_t i) {
+      return views.size() == 1 ? string("mandelbrot.png") : "mandelbrot_" + std::to_string(i) + ".png";
+    };
+
+    if (settings.frames > 0) {
+      ExecuteFrames(q, settings);
+    } else if (settings.perturbation) {
+      MandelPerturbation m_deep(settings.rows, settings.cols, views[0].max_iterations, views[0].view);
+      MandelPerturbation m_check(settings.rows, settings.cols, views[0].max_iterations, views[0].view);
+      for (size_t i = 0; i < views.size(); ++i) {
+        m_deep.SetDeepView(views[i].view, views[i].max_iterations);
+        m_check.SetDeepView(views[i].view, views[i].max_iterations);
+        ExecuteDeep(q, m_deep, m_check, settings, (int)i, image_name(i));
+      }
+    } else {
+      // One pair of images for the whole batch; the kernels are compiled once
+      MandelParallel m_par(settings.rows, settings.cols, views[0].max_iterations, views[0].view.Approximate());
+      MandelThreaded m_host(settings.rows, settings.cols, views[0].max_iterations, 0, 64, views[0].view.Approximate());
+      for (size_t i = 0; i < views.size(); ++i) {
+        m_par.SetView(views[i].view.Approximate(), views[i].max_iterations);
+        m_host.SetView(views[i].view.Approximate(), views[i].max_iterations);
+        // launch the body of the application
+        Execute(q, m_par, m_host, settings, (int)i, image_name(i));
+      }
+    }
   } catch (...) {
     // some other exception detected
     cout << "Failure\n";
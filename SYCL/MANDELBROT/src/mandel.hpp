@@ -6,46 +6,101 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <complex>
+#include <deque>
 #include <exception>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #define STB_IMAGE_IMPLEMENTATION
 #include "../stb/stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "../stb/stb_image_write.h"
+#include "image_writer.hpp"
+
+// MandelSimd uses AVX-512 or AVX2 when the host compile enables them
+// (e.g. -march=native), and a portable lane loop otherwise.
+#if !defined(__SYCL_DEVICE_ONLY__) && (defined(__AVX512F__) || defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+// Keeps the compiler from fusing MandelSimd's multiplies and adds into
+// FMAs, which it would otherwise do differently depending on where the
+// lane loop gets inlined, changing a few escape counts.  Point needs the
+// same, for host and device code; the build compiles the targets that
+// include this header with MANDEL_FP_OPTIONS (-fp-model=precise or
+// -ffp-contract=off, see MANDELBROT/CMakeLists.txt).
+#if defined(__clang__)
+#define MANDEL_STRICT_FP_ATTR
+#define MANDEL_STRICT_FP _Pragma("clang fp contract(off)")
+#elif defined(__GNUC__)
+#define MANDEL_STRICT_FP_ATTR __attribute__((optimize("fp-contract=off")))
+#define MANDEL_STRICT_FP
+#else
+#define MANDEL_STRICT_FP_ATTR
+#define MANDEL_STRICT_FP
+#endif
 
 using namespace cl::sycl;
 
+// Defaults of the mandelbrot driver, all can be changed on its command line
 constexpr int row_size = 32768;
 constexpr int col_size = 32768;
 constexpr int max_iterations = 100;
 constexpr int repetitions = 100;
 
+// Part of the complex plane to render.  Rows run along the real axis and
+// columns along the imaginary axis; at zoom 1 the shorter image edge spans
+// 2, so the default view of a square image is -1.5..0.5 x -1..1.
+struct MandelView {
+  double center_real = -0.5;
+  double center_imag = 0.0;
+  double zoom = 1.0;
+};
+
 struct MandelParameters {
   int row_count_;
   int col_count_;
   int max_iterations_;
+  float row_origin_;  // point of pixel (0, 0)
+  float col_origin_;
+  float step_;        // distance between neighbouring pixels
 
   typedef std::complex<float> ComplexF;
 
-  MandelParameters(int row_count, int col_count, int max_iterations)
+  MandelParameters(int row_count, int col_count, int max_iterations, const MandelView &view = MandelView())
       : row_count_(row_count),
         col_count_(col_count),
-        max_iterations_(max_iterations) { }
+        max_iterations_(max_iterations) {
+    const double step = 2.0 / (view.zoom * std::min(row_count, col_count));
+    row_origin_ = (float)(view.center_real - step * row_count / 2);
+    col_origin_ = (float)(view.center_imag - step * col_count / 2);
+    step_ = (float)step;
+  }
 
   int row_count() const { return row_count_; }
   int col_count() const { return col_count_; }
   int max_iterations() const { return max_iterations_; } 
 
-  // scale from 0..row_count to -1.5..0.5
-  float ScaleRow(int i) const { return -1.5f + (i * (2.0f / row_count_)); }
+  // scale from 0..row_count to the real extent of the view
+  float ScaleRow(int i) const { return row_origin_ + i * step_; }
 
-  // scale from 0..col_count to -1..1
-  float ScaleCol(int i) const { return -1.0f + (i * (2.0f / col_count_)); }
+  // scale from 0..col_count to the imaginary extent of the view
+  float ScaleCol(int i) const { return col_origin_ + i * step_; }
 
   // mandelbrot set are points that do not diverge within max_iterations
-  int Point(const ComplexF& c) const {
+  int Point(const ComplexF& c) const { return Map(Iterations(c)); }
+
+  // raw iteration count of c, max_iterations_ if it does not diverge
+  int Iterations(const ComplexF& c) const {
     int count = 0;
     ComplexF z = 0;
     for (int i = 0; i < max_iterations_; ++i) {
@@ -58,66 +113,108 @@ struct MandelParameters {
       z = z * z + c;
       count++;
     }
-    if (count < max_iterations_) return (255*count)/max_iterations_-1;
+    return count;
+  }
+
+  // iteration count to the stored pixel value
+  int Map(int count) const {
+    if (count < max_iterations_) return (int)(255LL*count/max_iterations_)-1;
     else
     return count;
   }
 };
 
+// Result of Mandel::Compare: mismatching pixels overall and per square
+// tile, for locating where two engines diverge numerically.
+struct MandelDiff {
+  long long diff = 0;      // mismatches among the compared pixels
+  long long compared = 0;  // pixels compared
+  bool stopped = false;    // the tolerance was exceeded before every tile was compared
+  int rows = 0, cols = 0;  // image size
+  int tile = 0;            // tile edge in pixels
+  int tile_rows = 0, tile_cols = 0;
+  std::vector<int> tiles;  // mismatches per tile, row-major, -1 if not compared
+
+  // One character per tile: ' ' none, '.' under 1%, '+' under 10%,
+  // '#' 10% or more of the tile's pixels differ, '?' not compared.
+  void PrintMap(std::ostream &out = std::cout) const {
+    out << "Mismatch map (" << tile << "x" << tile << " tiles, ' ' 0, '.' <1%, '+' <10%, '#' >=10%, '?' skipped), "
+        << diff << " of " << compared << " compared pixels differ" << (stopped ? ", stopped early" : "") << ":\n";
+    for (int r = 0; r < tile_rows; ++r) {
+      std::string line(tile_cols, ' ');
+      for (int c = 0; c < tile_cols; ++c) {
+        const int d = tiles[(size_t)r * tile_cols + c];
+        const double pixels = (double)(std::min(rows, (r + 1) * tile) - r * tile) * (std::min(cols, (c + 1) * tile) - c * tile);
+        line[c] = d < 0 ? '?' : d == 0 ? ' ' : d < 0.01 * pixels ? '.' : d < 0.1 * pixels ? '+' : '#';
+      }
+      out << "  |" << line << "|\n";
+    }
+  }
+};
+
+// Colour-maps a row_count x col_count image of pixel values and writes it
+// as PNG or PPM (by extension) in row strips, converted in parallel,
+// without a full RGB copy in memory.  Image x runs along the data rows,
+// so each strip is a blocked transpose of the data.
+inline void MandelWriteImage(const std::string &file_name, const int *data, int row_count, int col_count) {
+  image_writer::WriteRGB(file_name, row_count, col_count, [=](int y0, int y1, uint8_t *rgb) {
+    for (int x = 0; x < row_count; ++x) {
+      const int *src = data + (size_t)x * col_count;
+      for (int y = y0; y < y1; ++y) {
+        float g = src[y] / 255.f;
+        float b = src[y] / 64.f;
+        uint8_t *pixel = rgb + ((size_t)(y - y0) * row_count + x) * 3;
+        pixel[0] = 0;
+        pixel[1] = (uint8_t)int(255.99 * g);
+        pixel[2] = (uint8_t)int(255.99 * b);
+      }
+    }
+  });
+}
+
 class Mandel {
  private:
   MandelParameters p_;
+  MandelView view_;
   int *data_;  // [p_.row_count_][p_.col_count_];
 
  public:
 
-  Mandel(int row_count, int col_count, int max_iterations)
-      : p_(row_count, col_count, max_iterations) {
-    data_ = new int[ p_.row_count() * p_.col_count() ];
+  Mandel(int row_count, int col_count, int max_iterations, const MandelView &view = MandelView())
+      : p_(row_count, col_count, max_iterations, view), view_(view) {
+    data_ = new int[(size_t)p_.row_count() * p_.col_count()];
   }
 
-  ~Mandel() { delete[] data_; }
+  virtual ~Mandel() { delete[] data_; }
 
   MandelParameters GetParameters() const { return p_; }
-  
-
-   void writeImage()
-  {
-    constexpr int channel_num { 3 };
-    int row_count_ = p_.row_count();
-    int col_count_ = p_.col_count();
+  MandelView GetView() const { return view_; }
 
-    uint8_t *pixels_ = new uint8_t[col_count_ * row_count_ * channel_num];
+  // Brings data() up to date when the last evaluation left the image
+  // elsewhere (MandelParallel::EvaluateUsm).  writeImage, Print and
+  // Compare call it; other users of data() have to call it themselves.
+  virtual void SyncHost() const { }
 
-    int index = 0;
-
-    for (int j = 0; j < row_count_; ++j)
-    {
-      for (int i = 0; i < col_count_; ++i)
-      {
-       float r = 0.0f;
-       float g = data_[i * col_count_ + j]/255.f;
-       float b = data_[i * col_count_ + j]/64.f;
-
-        int ir = int(255.99 * r);
-        int ig = int(255.99 * g);
-        int ib = int(255.99 * b);
-
-        pixels_[index++] = ir;
-        pixels_[index++] = ig;
-        pixels_[index++] = ib;
-      }
-    }
+  // Moves to another view of the same image size, keeping the allocation
+  void SetView(const MandelView &view, int max_iterations) {
+    p_ = MandelParameters(p_.row_count(), p_.col_count(), max_iterations, view);
+    view_ = view;
+  }
+  
 
-    stbi_write_png("mandelbrot.png", row_count_, col_count_, channel_num, pixels_, col_count_ * channel_num);
+  // Writes the image as PNG or PPM (by extension), see MandelWriteImage.
+  void writeImage(const std::string &file_name = "mandelbrot.png") {
+    SyncHost();
+    MandelWriteImage(file_name, data_, p_.row_count(), p_.col_count());
   }
 
 
 
   // use only for debugging with small dimensions
   void Print() {
+    SyncHost();
     if (p_.row_count() > 128 || p_.col_count() > 128) {
-      std::cout << "No output to console due to large size. Output saved to mandelbrot.png. " << std::endl;
+      std::cout << "No output to console due to large size. Output saved to the PNG image. " << std::endl;
       return;
     }
     for (int i = 0; i < p_.row_count(); ++i) {
@@ -132,36 +229,79 @@ class Mandel {
   int *data() const { return data_; }
 
   // accessors to read a value into the mandelbrot data matrix
-  void SetValue(int i, int j, float v) { data_[i * p_.col_count_ + j] = v; }
+  void SetValue(int i, int j, float v) { data_[(size_t)i * p_.col_count_ + j] = v; }
 
   // accessors to store a value into the mandelbrot data matrix
-  int GetValue(int i, int j) const { return data_[i * p_.col_count_ + j]; }
+  int GetValue(int i, int j) const { return data_[(size_t)i * p_.col_count_ + j]; }
+
+  // Compares with m on all cores, tile by tile.  Once more than
+  // tolerance x pixels differ the remaining tiles are skipped, so a
+  // failing check returns early; tolerance >= 1 compares everything.
+  MandelDiff Compare(const Mandel &m, double tolerance = 1.0, int threads = 0) const {
+    if ((m.p_.row_count() != p_.row_count_) || (m.p_.col_count() != p_.col_count_))
+      throw std::invalid_argument("Compare: matrix size is different");
+    SyncHost();
+    m.SyncHost();
+
+    const int rows = p_.row_count(), cols = p_.col_count();
+    const long long budget = (long long)(tolerance * ((double)rows * cols));
+    threads = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+
+    MandelDiff result;
+    result.rows = rows;
+    result.cols = cols;
+    // The map is at most 64 x 64 tiles
+    result.tile = std::max(64, (std::max(rows, cols) + 63) / 64);
+    result.tile_rows = (rows + result.tile - 1) / result.tile;
+    result.tile_cols = (cols + result.tile - 1) / result.tile;
+    result.tiles.assign((size_t)result.tile_rows * result.tile_cols, -1);
+
+    std::atomic<int> next{0};
+    std::atomic<long long> diff{0}, compared{0};
+    std::atomic<bool> stop{false};
+    const int tiles = (int)result.tiles.size();
+    auto work = [&]() {
+      for (int k; !stop.load(std::memory_order_relaxed) && (k = next.fetch_add(1)) < tiles;) {
+        const int r0 = (k / result.tile_cols) * result.tile, c0 = (k % result.tile_cols) * result.tile;
+        const int r1 = std::min(r0 + result.tile, rows), c1 = std::min(c0 + result.tile, cols);
+        int d = 0;
+        for (int i = r0; i < r1; ++i) {
+          const int *a = data_ + (size_t)i * cols, *b = m.data_ + (size_t)i * cols;
+          for (int j = c0; j < c1; ++j) d += a[j] != b[j];
+        }
+        result.tiles[k] = d;
+        compared += (long long)(r1 - r0) * (c1 - c0);
+        if ((diff += d) > budget) stop = true;
+      }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < std::min(threads, tiles); ++t) pool.emplace_back(work);
+    work();
+    for (auto &th : pool) th.join();
+
+    result.diff = diff;
+    result.compared = compared;
+    result.stopped = result.compared < (long long)rows * cols;
+    return result;
+  }
 
   // validate the results match
-  void Verify(Mandel &m) {
+  void Verify(Mandel &m, double tolerance = 0.05) {
     if ((m.p_.row_count() != p_.row_count_) || (m.p_.col_count() != p_.col_count_)) {
       std::cout << "Fail verification - matrix size is different" << std::endl;
       throw std::runtime_error("Verification failure");
     }
 
-    int diff = 0;
-    for (int i = 0; i < p_.row_count(); ++i) {
-      for (int j = 0; j < p_.col_count(); ++j) {
-        if (m.GetValue(i,j) != GetValue(i,j)) 
-          diff++;
-      }
-    }
-
-    double tolerance = 0.05;
-    double ratio = (double)diff / (double)(p_.row_count() * p_.col_count());
+    MandelDiff d = Compare(m, tolerance);
 
 #if _DEBUG
-    std::cout << "diff: " << diff << std::endl;
-    std::cout << "total count: " << p_.row_count() * p_.col_count() << std::endl;
+    std::cout << "diff: " << d.diff << (d.stopped ? " (stopped early)" : "") << std::endl;
+    std::cout << "total count: " << (size_t)p_.row_count() * p_.col_count() << std::endl;
 #endif
 
-    if (ratio > tolerance) {
+    if (d.diff > (long long)(tolerance * ((double)p_.row_count() * p_.col_count()))) {
       std::cout << "Fail verification - diff larger than tolerance"<< std::endl;
+      d.PrintMap();
       throw std::runtime_error("Verification failure");
     }
 #if _DEBUG
@@ -171,10 +311,13 @@ class Mandel {
 };
 
 
+// Reference engine: Point pixel by pixel on one thread.  The driver
+// validates against MandelThreaded; MandelSerial is the ground truth that
+// MandelSimd's counts are defined to match.
 class MandelSerial : public Mandel {
 public:
-  MandelSerial(int row_count, int col_count, int max_iterations)
-    : Mandel(row_count, col_count, max_iterations) { }
+  MandelSerial(int row_count, int col_count, int max_iterations, const MandelView &view = MandelView())
+    : Mandel(row_count, col_count, max_iterations, view) { }
 
   void Evaluate() {
     // iterate over image and compute mandel for each point
@@ -189,10 +332,52 @@ public:
   }
 };
 
+// Work decomposition of MandelParallel::EvaluateTiles.  The tile edges
+// must be multiples of the work-group edges.
+struct MandelTileConfig {
+  int tile_rows = 32;
+  int tile_cols = 32;
+  int group_rows = 4;
+  int group_cols = 16;   // adjacent pixels of a row share a sub-group
+  int groups = 0;        // persistent work-groups, 0: 4 per compute unit
+};
+
+// Per-tile iteration totals.  `cost` is what SIMD execution pays: for every
+// sub-group step the slowest lane's count times the sub-group size, so
+// sum / cost is the fraction of lanes doing useful work.
+struct MandelTileStats {
+  long long sum = 0;
+  long long cost = 0;
+};
+
+// Border of the rectangle rows [r0, r1] x columns [c0, c1] (inclusive),
+// enumerated top row, bottom row, then the inner parts of the left and
+// right columns.  Used by the adaptive (Mariani-Silver) evaluations.
+inline int MandelBorderLength(int r0, int r1, int c0, int c1) {
+  const int h = r1 - r0 + 1, w = c1 - c0 + 1;
+  if (h == 1) return w;
+  if (w == 1) return h;
+  return 2 * w + 2 * (h - 2);
+}
+
+inline void MandelBorderPixel(int r0, int r1, int c0, int c1, int k, int &row, int &col) {
+  const int w = c1 - c0 + 1, side = r1 - r0 - 1;
+  if (k < w) { row = r0; col = c0 + k; return; }
+  k -= w;
+  if (k < w) { row = r1; col = c0 + k; return; }
+  k -= w;
+  row = r0 + 1 + (k < side ? k : k - side);
+  col = k < side ? c0 : c1;
+}
+
 class MandelParallel : public Mandel {
 public:
-  MandelParallel(int row_count, int col_count, int max_iterations)
-    : Mandel(row_count, col_count, max_iterations) { }
+  MandelParallel(int row_count, int col_count, int max_iterations, const MandelView &view = MandelView())
+    : Mandel(row_count, col_count, max_iterations, view) { }
+
+  ~MandelParallel() {
+    if (device_data_ != nullptr) free(device_data_, *usm_queue_);
+  }
 
   void Evaluate(queue &q) {
     // iterate over image and check if each point is in mandelbrot set
@@ -201,16 +386,9 @@ public:
     const int rows = p.row_count();
     const int cols = p.col_count();
 
+    host_stale_ = false;
     buffer<int, 2> data_buf(data(), range<2>(rows, cols)); // buffer
 
-    //int *data_buf = static_cast<int*>(malloc_shared(rows*cols*sizeof(int),q));
-
-    //int *data_bufh = static_cast<int*>(malloc(rows*cols*sizeof(int)));
-    //data_bufh = data();
-    //auto *data_buf = static_cast<int*>(malloc_device<int>(rows*cols,q));
-    //auto e1 = q.memcpy(data_buf,data_bufh,(sizeof(int)*rows*cols));
-    //e1.wait();
-
     // we submit a comamand group to the queue
     q.submit([&](handler &h) {
       // get access to the buffer
@@ -221,12 +399,589 @@ public:
         int i = int(index[0]);
         int j = int(index[1]);
         auto c = MandelParameters::ComplexF(p.ScaleRow(i), p.ScaleCol(j));
-        //data_buf[i][j] = p.Point(c);
-        //data_buf[i*rows + j] = p.Point(c);
 	b[index] = p.Point(c);
       });
     });
 
     q.wait_and_throw();
   }
+
+  // USM variant of Evaluate: the image stays in a device allocation made
+  // on the first call (again only if the queue's device changes), so a
+  // repetition is just the kernel.  The pixels are copied back by
+  // SyncHost when the host needs them.
+  void EvaluateUsm(queue &q) {
+    MandelParameters p = GetParameters();
+
+    const int rows = p.row_count();
+    const int cols = p.col_count();
+
+    if (device_data_ == nullptr || !(usm_queue_->get_context() == q.get_context()) ||
+        !(usm_queue_->get_device() == q.get_device())) {
+      if (device_data_ != nullptr) free(device_data_, *usm_queue_);
+      device_data_ = malloc_device<int>((size_t)rows * cols, q);
+      if (device_data_ == nullptr) throw std::runtime_error("malloc_device failed for the image");
+      usm_queue_ = q;
+    }
+
+    int *out = device_data_;
+    q.parallel_for(range<2>(rows, cols), [=](id<2> index) {
+      int i = int(index[0]);
+      int j = int(index[1]);
+      auto c = MandelParameters::ComplexF(p.ScaleRow(i), p.ScaleCol(j));
+      out[(size_t)i * cols + j] = p.Point(c);
+    });
+    q.wait_and_throw();
+    host_stale_ = true;
+  }
+
+  void SyncHost() const override {
+    if (!host_stale_) return;
+    MandelParameters p = GetParameters();
+    usm_queue_->memcpy(data(), device_data_, sizeof(int) * (size_t)p.row_count() * p.col_count()).wait();
+    host_stale_ = false;
+  }
+
+  // nd_range variant for load balance: cfg.groups persistent work-groups
+  // take tiles from a global atomic counter until the image is done, so a
+  // group that drew cheap tiles simply takes more of them.
+  void EvaluateTiles(queue &q, const MandelTileConfig &cfg) {
+    MandelParameters p = GetParameters();
+
+    const int rows = p.row_count();
+    const int cols = p.col_count();
+    const int TR = cfg.tile_rows, TC = cfg.tile_cols, WR = cfg.group_rows, WC = cfg.group_cols;
+    if (TR <= 0 || TC <= 0 || WR <= 0 || WC <= 0 || TR % WR != 0 || TC % WC != 0)
+      throw std::invalid_argument("tile edges must be positive multiples of the work-group edges");
+
+    const int tiles_c = (cols + TC - 1) / TC;
+    const int tiles = ((rows + TR - 1) / TR) * tiles_c;
+    const int groups = cfg.groups > 0 ? cfg.groups
+        : 4 * (int)q.get_device().get_info<info::device::max_compute_units>();
+
+    host_stale_ = false;
+    tile_stats_.assign(tiles, MandelTileStats());
+    int next_tile = 0;
+    {
+      buffer<int, 2> data_buf(data(), range<2>(rows, cols));
+      buffer<int, 1> next_buf(&next_tile, range<1>(1));
+      buffer<MandelTileStats, 1> stats_buf(tile_stats_.data(), range<1>(tiles));
+
+      q.submit([&](handler &h) {
+        auto b = data_buf.get_access<access::mode::write>(h);
+        auto next = next_buf.get_access<access::mode::read_write>(h);
+        auto stats = stats_buf.get_access<access::mode::write>(h);
+
+        h.parallel_for(nd_range<2>(range<2>(groups * WR, WC), range<2>(WR, WC)), [=](nd_item<2> it) {
+          auto g = it.get_group();
+          auto sg = it.get_sub_group();
+          const int ly = it.get_local_id(0), lx = it.get_local_id(1);
+
+          for (;;) {
+            int tile = 0;
+            if (it.get_local_linear_id() == 0) {
+              atomic_ref<int, memory_order::relaxed, memory_scope::device, access::address_space::global_space> counter(next[0]);
+              tile = counter.fetch_add(1);
+            }
+            tile = group_broadcast(g, tile);
+            if (tile >= tiles) break;
+
+            const int row0 = (tile / tiles_c) * TR, col0 = (tile % tiles_c) * TC;
+            long long sum = 0, cost = 0;
+            // Same trip count for every work-item, so the sub-group reductions line up
+            for (int i = ly; i < TR; i += WR)
+              for (int j = lx; j < TC; j += WC) {
+                const int row = row0 + i, col = col0 + j;
+                int n = 0;
+                if (row < rows && col < cols) {
+                  n = p.Iterations(MandelParameters::ComplexF(p.ScaleRow(row), p.ScaleCol(col)));
+                  b[row][col] = p.Map(n);
+                }
+                sum += n;
+                cost += reduce_over_group(sg, n, maximum<int>());
+              }
+
+            sum = reduce_over_group(g, sum, plus<long long>());
+            cost = reduce_over_group(g, cost, plus<long long>());
+            if (it.get_local_linear_id() == 0) {
+              stats[tile].sum = sum;
+              stats[tile].cost = cost;
+            }
+          }
+        });
+      });
+    }
+    q.wait_and_throw();
+  }
+
+  // Per-tile totals of the last EvaluateTiles.
+  const std::vector<MandelTileStats> &TileStats() const { return tile_stats_; }
+
+  // Overall SIMD efficiency, histogram of per-tile efficiency and the
+  // spread of per-tile work.
+  void PrintTileStats(std::ostream &out = std::cout) const {
+    if (tile_stats_.empty()) return;
+    constexpr int bins = 10;
+    int histogram[bins] = {};
+    long long sum = 0, cost = 0;
+    std::vector<long long> work;
+    for (const auto &t : tile_stats_) {
+      sum += t.sum;
+      cost += t.cost;
+      work.push_back(t.sum);
+      double efficiency = t.cost > 0 ? (double)t.sum / t.cost : 1.0;
+      histogram[std::min(bins - 1, (int)(efficiency * bins))]++;
+    }
+    std::sort(work.begin(), work.end());
+
+    out << "  tiles: " << tile_stats_.size() << ", SIMD efficiency (useful / paid lane iterations): "
+        << (cost > 0 ? (double)sum / cost : 1.0) << "\n";
+    out << "  iterations per tile: min " << work.front() << ", median " << work[work.size() / 2]
+        << ", max " << work.back() << "\n";
+    out << "  tiles by efficiency:\n";
+    for (int i = 0; i < bins; ++i)
+      out << "    " << std::setw(3) << 100 * i / bins << "-" << std::setw(3) << 100 * (i + 1) / bins
+          << "% : " << histogram[i] << "\n";
+  }
+
+  // Adaptive (Mariani-Silver) variant: one work-group per tile x tile
+  // block.  Only rectangle borders are iterated; a rectangle whose border
+  // has a single value is filled with it, otherwise it is split in four
+  // along its middle row and column, which are iterated and become the
+  // borders of the children.  Rectangles of at most min_size pixels per
+  // side are iterated in full.  The group walks the subdivision one level
+  // at a time, keeping the pending rectangles in local memory.
+  void EvaluateAdaptive(queue &q, int tile = 64, int min_size = 8, int group_size = 64) {
+    MandelParameters p = GetParameters();
+
+    const int rows = p.row_count();
+    const int cols = p.col_count();
+    if (tile < 3 || min_size < 2 || group_size <= 0)
+      throw std::invalid_argument("adaptive evaluation needs tile >= 3, min_size >= 2 and group_size > 0");
+
+    // A split turns an s-pixel side into at most s / 2 + 1
+    int levels = 0;
+    for (int s = tile; s > min_size; s = s / 2 + 1) levels++;
+    const int capacity = 1 << (2 * levels);  // most rectangles on one level
+    if (2 * 4 * sizeof(int) * (size_t)capacity > q.get_device().get_info<info::device::local_mem_size>())
+      throw std::invalid_argument("adaptive tile too large for local memory, raise min_size or lower tile");
+    group_size = std::min(group_size, (int)q.get_device().get_info<info::device::max_work_group_size>());
+
+    const int tiles_c = (cols + tile - 1) / tile;
+    const int tiles = ((rows + tile - 1) / tile) * tiles_c;
+    host_stale_ = false;
+    std::vector<int> evaluated(tiles, 0);
+    {
+      buffer<int, 2> data_buf(data(), range<2>(rows, cols));
+      buffer<int, 1> evaluated_buf(evaluated.data(), range<1>(tiles));
+
+      q.submit([&](handler &h) {
+        auto b = data_buf.get_access<access::mode::read_write>(h);
+        auto work = evaluated_buf.get_access<access::mode::write>(h);
+        local_accessor<int, 1> rects(range<1>(2 * 4 * capacity), h);  // two levels of (r0, r1, c0, c1)
+        local_accessor<int, 1> counts(range<1>(2), h);
+
+        h.parallel_for(nd_range<1>(range<1>((size_t)tiles * group_size), range<1>(group_size)), [=](nd_item<1> it) {
+          auto g = it.get_group();
+          const int lid = it.get_local_linear_id(), size = group_size;
+          const int t = it.get_group(0);
+          const int t_r0 = (t / tiles_c) * tile, t_c0 = (t % tiles_c) * tile;
+          const int t_r1 = sycl::min(t_r0 + tile, rows) - 1, t_c1 = sycl::min(t_c0 + tile, cols) - 1;
+          int n = 0;  // pixels iterated by this work-item
+
+          auto pixel = [&](int row, int col) {
+            b[row][col] = p.Point(MandelParameters::ComplexF(p.ScaleRow(row), p.ScaleCol(col)));
+            n++;
+          };
+
+          for (int k = lid; k < MandelBorderLength(t_r0, t_r1, t_c0, t_c1); k += size) {
+            int row, col;
+            MandelBorderPixel(t_r0, t_r1, t_c0, t_c1, k, row, col);
+            pixel(row, col);
+          }
+          if (lid == 0) {
+            rects[0] = t_r0; rects[1] = t_r1; rects[2] = t_c0; rects[3] = t_c1;
+            counts[0] = 1;
+          }
+          group_barrier(g);
+
+          for (int cur = 0; counts[cur] > 0; cur = 1 - cur) {
+            const int next = 1 - cur, pending = counts[cur];
+            if (lid == 0) counts[next] = 0;
+
+            for (int i = 0; i < pending; ++i) {
+              const int base = (cur * capacity + i) * 4;
+              const int r0 = rects[base], r1 = rects[base + 1], c0 = rects[base + 2], c1 = rects[base + 3];
+              const int ih = r1 - r0 - 1, iw = c1 - c0 - 1;  // interior
+
+              const int v = b[r0][c0];
+              bool uniform = true;
+              for (int k = lid; k < MandelBorderLength(r0, r1, c0, c1); k += size) {
+                int row, col;
+                MandelBorderPixel(r0, r1, c0, c1, k, row, col);
+                uniform = uniform && b[row][col] == v;
+              }
+              uniform = all_of_group(g, uniform);
+
+              if (ih > 0 && iw > 0) {
+                if (uniform) {
+                  for (int k = lid; k < ih * iw; k += size) b[r0 + 1 + k / iw][c0 + 1 + k % iw] = v;
+                } else if (r1 - r0 + 1 <= min_size || c1 - c0 + 1 <= min_size) {
+                  for (int k = lid; k < ih * iw; k += size) pixel(r0 + 1 + k / iw, c0 + 1 + k % iw);
+                } else {
+                  // middle row, then the middle column above and below it
+                  const int mr = (r0 + r1) / 2, mc = (c0 + c1) / 2;
+                  for (int k = lid; k < iw + ih - 1; k += size) {
+                    if (k < iw) {
+                      pixel(mr, c0 + 1 + k);
+                    } else {
+                      const int row = r0 + 1 + (k - iw);
+                      pixel(row < mr ? row : row + 1, mc);
+                    }
+                  }
+                  if (lid == 0) {
+                    const int quad[4][4] = {{r0, mr, c0, mc}, {r0, mr, mc, c1}, {mr, r1, c0, mc}, {mr, r1, mc, c1}};
+                    for (int c = 0; c < 4; ++c) {
+                      const int dst = (next * capacity + counts[next]++) * 4;
+                      for (int e = 0; e < 4; ++e) rects[dst + e] = quad[c][e];
+                    }
+                  }
+                }
+              }
+              group_barrier(g);
+            }
+          }
+
+          n = reduce_over_group(g, n, plus<int>());
+          if (lid == 0) work[t] = n;
+        });
+      });
+    }
+    q.wait_and_throw();
+
+    evaluated_ = 0;
+    for (int e : evaluated) evaluated_ += e;
+  }
+
+  // Pixels iterated by the last EvaluateAdaptive.
+  long long Evaluated() const { return evaluated_; }
+
+private:
+  std::vector<MandelTileStats> tile_stats_;
+  long long evaluated_ = 0;
+  // EvaluateUsm's image; host_stale_ while data() lags behind it
+  int *device_data_ = nullptr;
+  mutable std::optional<queue> usm_queue_;  // not constructed before EvaluateUsm
+  mutable bool host_stale_ = false;
+};
+
+// Host engine that iterates a group of adjacent pixels of one row at a
+// time, one pixel per SIMD lane.  Each lane keeps a sticky escape mask and
+// the group stops as soon as every lane has escaped.  The arithmetic
+// follows MandelParameters::Point step for step (|z|^2 test, then
+// z = z*z + c with the same products and sums, then the same count
+// mapping) without FMA contraction, so the counts are identical to
+// MandelSerial as long as Point is built with MANDEL_FP_OPTIONS too.
+class MandelSimd : public Mandel {
+public:
+#if defined(__AVX512F__)
+  static constexpr int lanes = 16;
+#else
+  static constexpr int lanes = 8;
+#endif
+
+  MandelSimd(int row_count, int col_count, int max_iterations, const MandelView &view = MandelView())
+    : Mandel(row_count, col_count, max_iterations, view) { }
+
+  void Evaluate() {
+    MandelParameters p = GetParameters();
+    EvaluateTile(0, p.row_count(), 0, p.col_count());
+  }
+
+  // rows [row_begin, row_end) x columns [col_begin, col_end).  The pixels
+  // are dealt to the lanes in row-major order across row ends, so narrow
+  // rectangles (down to a single column) still fill every lane.
+  void EvaluateTile(int row_begin, int row_end, int col_begin, int col_end) {
+    MandelParameters p = GetParameters();
+    int *out = data();
+    if (row_end <= row_begin || col_end <= col_begin) return;
+
+    const int width = col_end - col_begin;
+    const long long total = (long long)(row_end - row_begin) * width;
+    for (long long k = 0; k < total; k += lanes) {
+      alignas(64) float cr[lanes];
+      alignas(64) float ci[lanes];
+      alignas(64) int count[lanes];
+      const int n = (int)std::min<long long>(lanes, total - k);
+      for (int l = 0; l < lanes; ++l) {
+        const long long e = k + std::min(l, n - 1);  // spare lanes repeat the last pixel
+        cr[l] = p.ScaleRow(row_begin + (int)(e / width));
+        ci[l] = p.ScaleCol(col_begin + (int)(e % width));
+      }
+
+      Counts(cr, ci, p.max_iterations(), count);
+
+      for (int l = 0; l < n; ++l) {
+        const int i = row_begin + (int)((k + l) / width), j = col_begin + (int)((k + l) % width);
+        out[(size_t)i * p.col_count() + j] = p.Map(count[l]);
+      }
+    }
+  }
+
+private:
+  // Raw iteration counts of `lanes` points cr[l] + i*ci[l].
+  MANDEL_STRICT_FP_ATTR static void Counts(const float *cr, const float *ci, int max_iterations, int *count) {
+    MANDEL_STRICT_FP
+#if !defined(__SYCL_DEVICE_ONLY__) && defined(__AVX512F__)
+    const __m512 four = _mm512_set1_ps(4.0f), vcr = _mm512_load_ps(cr), vci = _mm512_load_ps(ci);
+    const __m512i one = _mm512_set1_epi32(1);
+    __m512 zr = _mm512_setzero_ps(), zi = _mm512_setzero_ps();
+    __m512i cnt = _mm512_setzero_si512();
+    __mmask16 alive = 0xFFFF;
+    for (int it = 0; it < max_iterations && alive; ++it) {
+      __m512 rr = _mm512_mul_ps(zr, zr), ii = _mm512_mul_ps(zi, zi), ri = _mm512_mul_ps(zr, zi);
+      alive &= _mm512_cmp_ps_mask(_mm512_add_ps(rr, ii), four, _CMP_LT_OQ);
+      cnt = _mm512_mask_add_epi32(cnt, alive, cnt, one);
+      zr = _mm512_add_ps(_mm512_sub_ps(rr, ii), vcr);
+      zi = _mm512_add_ps(_mm512_add_ps(ri, ri), vci);
+    }
+    _mm512_store_si512(count, cnt);
+#elif !defined(__SYCL_DEVICE_ONLY__) && defined(__AVX2__)
+    const __m256 four = _mm256_set1_ps(4.0f), vcr = _mm256_load_ps(cr), vci = _mm256_load_ps(ci);
+    __m256 zr = _mm256_setzero_ps(), zi = _mm256_setzero_ps();
+    __m256 alive = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256i cnt = _mm256_setzero_si256();
+    for (int it = 0; it < max_iterations; ++it) {
+      __m256 rr = _mm256_mul_ps(zr, zr), ii = _mm256_mul_ps(zi, zi), ri = _mm256_mul_ps(zr, zi);
+      alive = _mm256_and_ps(alive, _mm256_cmp_ps(_mm256_add_ps(rr, ii), four, _CMP_LT_OQ));
+      if (_mm256_movemask_ps(alive) == 0) break;
+      // alive lanes are all ones, i.e. -1
+      cnt = _mm256_sub_epi32(cnt, _mm256_castps_si256(alive));
+      zr = _mm256_add_ps(_mm256_sub_ps(rr, ii), vcr);
+      zi = _mm256_add_ps(_mm256_add_ps(ri, ri), vci);
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i *>(count), cnt);
+#else
+    // Branch-free inner loop so the compiler can vectorize it
+    float zr[lanes] = {}, zi[lanes] = {};
+    int alive[lanes];
+    for (int l = 0; l < lanes; ++l) { alive[l] = 1; count[l] = 0; }
+    for (int it = 0; it < max_iterations; ++it) {
+      int any = 0;
+      for (int l = 0; l < lanes; ++l) {
+        float rr = zr[l] * zr[l], ii = zi[l] * zi[l], ri = zr[l] * zi[l];
+        alive[l] &= (rr + ii) < 4.0f;
+        count[l] += alive[l];
+        any |= alive[l];
+        zr[l] = (rr - ii) + cr[l];
+        zi[l] = (ri + ri) + ci[l];
+      }
+      if (!any) break;
+    }
+#endif
+  }
+};
+
+// Per-thread statistics of one MandelThreaded::Evaluate.
+struct MandelLoad {
+  double busy = 0.0;  // seconds spent computing pixels
+  int tiles = 0;      // tiles (or row bands) computed
+  int steals = 0;     // tiles taken from another thread's queue
+};
+
+// Multithreaded host engine on top of MandelSimd.  The cost per pixel is
+// very uneven near the set boundary, so two schedules are offered:
+//
+//   static_rows    one contiguous band of rows per thread
+//   dynamic_tiles  tile x tile blocks dealt in contiguous runs to per-thread
+//                  queues; a thread pops from the front of its own queue
+//                  and, once it is empty, steals from the back of others
+//
+// Load() reports per-thread busy time, tiles and steals so the two can be
+// compared.  EvaluateAdaptive() runs the dynamic_tiles schedule with
+// Mariani-Silver subdivision inside each tile (see
+// MandelParallel::EvaluateAdaptive).
+class MandelThreaded : public MandelSimd {
+public:
+  enum class Schedule { static_rows, dynamic_tiles };
+
+  // threads = 0 uses std::thread::hardware_concurrency()
+  MandelThreaded(int row_count, int col_count, int max_iterations, int threads = 0, int tile = 64,
+                 const MandelView &view = MandelView())
+    : MandelSimd(row_count, col_count, max_iterations, view),
+      threads_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      tile_(std::max(1, tile)) { }
+
+  int threads() const { return threads_; }
+  int tile() const { return tile_; }
+  const std::vector<MandelLoad> &Load() const { return load_; }
+
+  void Evaluate(Schedule schedule) {
+    load_.assign(threads_, MandelLoad());
+    if (schedule == Schedule::static_rows)
+      Run([this](int t) { StaticRows(t); });
+    else
+      EvaluateTiles();
+  }
+
+  // Iterates only rectangle borders and fills rectangles whose border has
+  // a single value; rectangles of at most min_size pixels per side are
+  // iterated in full.
+  void EvaluateAdaptive(int min_size = 8) {
+    adaptive_min_ = std::max(2, min_size);
+    evaluated_ = 0;
+    load_.assign(threads_, MandelLoad());
+    EvaluateTiles();
+    adaptive_min_ = 0;
+  }
+
+  // Pixels iterated by the last EvaluateAdaptive.
+  long long Evaluated() const { return evaluated_; }
+
+  // One line per thread plus the imbalance, max busy / mean busy.
+  void PrintLoad(std::ostream &out = std::cout) const {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    double max_busy = 0.0, sum_busy = 0.0;
+    for (int t = 0; t < threads_; ++t) {
+      out << "  thread " << std::setw(3) << t << " : busy " << std::fixed << std::setprecision(6) << load_[t].busy
+          << " s, tiles " << load_[t].tiles << ", steals " << load_[t].steals << "\n";
+      max_busy = std::max(max_busy, load_[t].busy);
+      sum_busy += load_[t].busy;
+    }
+    out << "  imbalance (max/mean busy) : " << std::setprecision(3)
+        << (sum_busy > 0.0 ? max_busy * threads_ / sum_busy : 1.0) << "\n";
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+private:
+  // Per-thread tile queue, padded so neighbouring locks do not share a line
+  struct alignas(64) TileQueue {
+    std::mutex lock;
+    std::deque<int> tiles;
+  };
+
+  template <class Body>
+  void Run(Body body) {
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads_; ++t) pool.emplace_back(body, t);
+    body(0);
+    for (auto &th : pool) th.join();
+  }
+
+  static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  void StaticRows(int t) {
+    MandelParameters p = GetParameters();
+    const int begin = (int)((long long)p.row_count() * t / threads_);
+    const int end = (int)((long long)p.row_count() * (t + 1) / threads_);
+    auto start = std::chrono::steady_clock::now();
+    EvaluateTile(begin, end, 0, p.col_count());
+    load_[t].busy = Seconds(start);
+    load_[t].tiles = 1;
+  }
+
+  void EvaluateTiles() {
+    MandelParameters p = GetParameters();
+    const int tile_rows = (p.row_count() + tile_ - 1) / tile_;
+    const int tile_cols = (p.col_count() + tile_ - 1) / tile_;
+    const int total = tile_rows * tile_cols;
+
+    // Contiguous runs of tiles per thread keep neighbouring rows together
+    std::vector<TileQueue> queues(threads_);
+    for (int t = 0; t < threads_; ++t)
+      for (int k = (int)((long long)total * t / threads_); k < (int)((long long)total * (t + 1) / threads_); ++k)
+        queues[t].tiles.push_back(k);
+
+    Run([&](int t) {
+      auto start = std::chrono::steady_clock::now();
+      double idle = 0.0;
+      int tiles = 0, steals = 0;
+      for (;;) {
+        int k = -1;
+        {
+          std::lock_guard<std::mutex> guard(queues[t].lock);
+          if (!queues[t].tiles.empty()) {
+            k = queues[t].tiles.front();
+            queues[t].tiles.pop_front();
+          }
+        }
+        if (k < 0) {
+          auto search = std::chrono::steady_clock::now();
+          for (int v = 1; v < threads_ && k < 0; ++v) {
+            TileQueue &victim = queues[(t + v) % threads_];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tiles.empty()) {
+              k = victim.tiles.back();
+              victim.tiles.pop_back();
+              steals++;
+            }
+          }
+          idle += Seconds(search);
+          if (k < 0) break;  // tiles are never added, so every queue is empty
+        }
+
+        const int r0 = (k / tile_cols) * tile_, c0 = (k % tile_cols) * tile_;
+        const int r1 = std::min(r0 + tile_, p.row_count()), c1 = std::min(c0 + tile_, p.col_count());
+        if (adaptive_min_ > 0)
+          evaluated_ += AdaptiveTile(r0, r1, c0, c1);
+        else
+          EvaluateTile(r0, r1, c0, c1);
+        tiles++;
+      }
+      load_[t].busy = Seconds(start) - idle;
+      load_[t].tiles = tiles;
+      load_[t].steals = steals;
+    });
+  }
+
+  // EvaluateTile on [row_begin, row_end) x [col_begin, col_end), returns the pixel count
+  long long Span(int row_begin, int row_end, int col_begin, int col_end) {
+    if (row_end <= row_begin || col_end <= col_begin) return 0;
+    EvaluateTile(row_begin, row_end, col_begin, col_end);
+    return (long long)(row_end - row_begin) * (col_end - col_begin);
+  }
+
+  // Border of the tile, then its subdivision; returns the pixels iterated
+  long long AdaptiveTile(int row_begin, int row_end, int col_begin, int col_end) {
+    long long n = Span(row_begin, row_begin + 1, col_begin, col_end);
+    if (row_end - row_begin > 1) n += Span(row_end - 1, row_end, col_begin, col_end);
+    n += Span(row_begin + 1, row_end - 1, col_begin, col_begin + 1);
+    if (col_end - col_begin > 1) n += Span(row_begin + 1, row_end - 1, col_end - 1, col_end);
+    return n + Subdivide(row_begin, row_end - 1, col_begin, col_end - 1);
+  }
+
+  // Rectangle [r0, r1] x [c0, c1] (inclusive) whose border is already computed
+  long long Subdivide(int r0, int r1, int c0, int c1) {
+    if (r1 - r0 < 2 || c1 - c0 < 2) return 0;  // no interior
+    const int cols = GetParameters().col_count();
+    int *out = data();
+
+    const int v = out[(size_t)r0 * cols + c0];
+    bool uniform = true;
+    for (int k = 0; uniform && k < MandelBorderLength(r0, r1, c0, c1); ++k) {
+      int row, col;
+      MandelBorderPixel(r0, r1, c0, c1, k, row, col);
+      uniform = out[(size_t)row * cols + col] == v;
+    }
+    if (uniform) {
+      for (int i = r0 + 1; i < r1; ++i) std::fill(out + (size_t)i * cols + c0 + 1, out + (size_t)i * cols + c1, v);
+      return 0;
+    }
+    if (r1 - r0 + 1 <= adaptive_min_ || c1 - c0 + 1 <= adaptive_min_) return Span(r0 + 1, r1, c0 + 1, c1);
+
+    const int mr = (r0 + r1) / 2, mc = (c0 + c1) / 2;
+    long long n = Span(mr, mr + 1, c0 + 1, c1) + Span(r0 + 1, mr, mc, mc + 1) + Span(mr + 1, r1, mc, mc + 1);
+    return n + Subdivide(r0, mr, c0, mc) + Subdivide(r0, mr, mc, c1) + Subdivide(mr, r1, c0, mc) +
+           Subdivide(mr, r1, mc, c1);
+  }
+
+  int threads_;
+  int tile_;
+  int adaptive_min_ = 0;
+  std::atomic<long long> evaluated_{0};
+  std::vector<MandelLoad> load_;
 };
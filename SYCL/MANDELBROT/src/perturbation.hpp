@@ -0,0 +1,340 @@
+//==============================================================
+// Deep-zoom Mandelbrot by perturbation.
+//
+// Float pixels run out of resolution around zoom 1e5 and double ones
+// around 1e13.  Here one reference orbit Z_n of the view center C is
+// iterated on the host in fixed point with as many bits as the zoom
+// needs (MandelBig), and every pixel c = C + dc only iterates its offset
+// from it in ordinary floating point:
+//
+//   z_n = Z_n + dz_n,   dz_{n+1} = 2 Z_n dz_n + dz_n^2 + dc
+//
+// The offsets are small, so double (float on devices without fp64) keeps
+// them accurate down to the exponent range rather than the mantissa.
+//
+// Where the pixel orbit gets closer to 0 than its offset, Z_n + dz_n loses
+// the precision the offset had (the classic perturbation glitch).  Those
+// pixels are rebased instead of recomputed: the full value becomes the
+// new offset against Z_0 = 0 and the reference index restarts (Zhuoran's
+// method).  The same rebase continues pixels past the end of a reference
+// orbit that escaped early.  Rebased() counts the pixels that needed it.
+//
+// The counts use the same |z|^2 >= 4 test and mapping as
+// MandelParameters, so shallow views can be checked against the other
+// engines and EvaluateHost checks the device at any depth.
+// =============================================================
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mandel.hpp"
+
+// Signed fixed-point number: limb 0 holds the integer part, the other
+// limbs 32 fraction bits each.  Only what the reference orbit needs.
+class MandelBig {
+public:
+  explicit MandelBig(int limbs = 2) : limb_(std::max(2, limbs), 0) { }
+
+  // Decimal such as "-0.743643887037158704752191506114774" or "1.5e-3"
+  static MandelBig Parse(const std::string &text, int limbs) {
+    MandelBig x(limbs);
+    size_t pos = 0;
+    bool neg = false;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) neg = text[pos++] == '-';
+    std::string digits;
+    int point = -1, exponent = 0;
+    for (; pos < text.size(); ++pos) {
+      const char ch = text[pos];
+      if (ch >= '0' && ch <= '9') digits += ch;
+      else if (ch == '.' && point < 0) point = (int)digits.size();
+      else if (ch == 'e' || ch == 'E') { exponent = std::stoi(text.substr(pos + 1)); break; }
+      else throw std::invalid_argument("bad number '" + text + "'");
+    }
+    if (digits.empty()) throw std::invalid_argument("bad number '" + text + "'");
+    if (point < 0) point = (int)digits.size();
+
+    // Digits left of the decimal point (after the exponent) go into the
+    // integer limb; the others are added from the last one, dividing by 10
+    const int split = point + exponent;
+    for (int k = (int)digits.size() - 1; k >= std::max(0, split); --k) {
+      x.limb_[0] += digits[k] - '0';
+      x.DivSmall(10);
+    }
+    for (int k = split; k < 0; ++k) x.DivSmall(10);  // zeros between the point and the first digit
+    uint64_t integer = 0;
+    for (int k = 0; k < std::min(split, (int)digits.size()); ++k) integer = integer * 10 + (digits[k] - '0');
+    for (int k = (int)digits.size(); k < split; ++k) integer *= 10;
+    if (integer >= (1ull << 31)) throw std::invalid_argument("number too large '" + text + "'");
+    x.limb_[0] += (uint32_t)integer;
+    x.neg_ = neg && !x.IsZero();
+    return x;
+  }
+
+  double ToDouble() const {
+    double v = 0.0, scale = 1.0;
+    for (size_t k = 0; k < limb_.size() && k < 4; ++k, scale /= 4294967296.0) v += limb_[k] * scale;
+    return neg_ ? -v : v;
+  }
+
+  friend MandelBig operator+(const MandelBig &a, const MandelBig &b) { return AddSigned(a, b, b.neg_); }
+  friend MandelBig operator-(const MandelBig &a, const MandelBig &b) { return AddSigned(a, b, !b.neg_); }
+
+  friend MandelBig operator*(const MandelBig &a, const MandelBig &b) {
+    const size_t n = a.limb_.size();
+    // Schoolbook product on little-endian limbs (index 0 least significant);
+    // of its 2n limbs, 2(n-1) are fraction limbs, keep the n around the point
+    std::vector<uint32_t> product(2 * n, 0);
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t carry = 0;
+      const uint64_t ai = a.limb_[n - 1 - i];
+      for (size_t j = 0; j < n; ++j) {
+        const uint64_t t = ai * b.limb_[n - 1 - j] + product[i + j] + carry;
+        product[i + j] = (uint32_t)t;
+        carry = t >> 32;
+      }
+      product[i + n] = (uint32_t)carry;
+    }
+    MandelBig r((int)n);
+    for (size_t k = 0; k < n; ++k) r.limb_[n - 1 - k] = product[k + n - 1];
+    r.neg_ = (a.neg_ != b.neg_) && !r.IsZero();
+    return r;
+  }
+
+private:
+  bool IsZero() const {
+    for (uint32_t l : limb_)
+      if (l) return false;
+    return true;
+  }
+
+  void DivSmall(uint32_t d) {
+    uint64_t rem = 0;
+    for (auto &l : limb_) {
+      const uint64_t cur = (rem << 32) | l;
+      l = (uint32_t)(cur / d);
+      rem = cur % d;
+    }
+  }
+
+  // |a| vs |b|
+  static int CompareMagnitude(const MandelBig &a, const MandelBig &b) {
+    for (size_t k = 0; k < a.limb_.size(); ++k)
+      if (a.limb_[k] != b.limb_[k]) return a.limb_[k] < b.limb_[k] ? -1 : 1;
+    return 0;
+  }
+
+  // a + (b_neg ? -|b| : |b|)
+  static MandelBig AddSigned(const MandelBig &a, const MandelBig &b, bool b_neg) {
+    MandelBig r((int)a.limb_.size());
+    if (a.neg_ == b_neg) {
+      uint64_t carry = 0;
+      for (size_t k = a.limb_.size(); k-- > 0;) {
+        const uint64_t t = (uint64_t)a.limb_[k] + b.limb_[k] + carry;
+        r.limb_[k] = (uint32_t)t;
+        carry = t >> 32;
+      }
+      r.neg_ = a.neg_;
+    } else {
+      const bool a_larger = CompareMagnitude(a, b) >= 0;
+      const MandelBig &big = a_larger ? a : b, &small = a_larger ? b : a;
+      int64_t borrow = 0;
+      for (size_t k = a.limb_.size(); k-- > 0;) {
+        int64_t t = (int64_t)big.limb_[k] - small.limb_[k] - borrow;
+        borrow = t < 0;
+        r.limb_[k] = (uint32_t)(t + (borrow << 32));
+      }
+      r.neg_ = a_larger ? a.neg_ : b_neg;
+    }
+    if (r.IsZero()) r.neg_ = false;
+    return r;
+  }
+
+  std::vector<uint32_t> limb_;
+  bool neg_ = false;
+};
+
+// View of the perturbation engine: the center as decimal strings so it
+// can carry more digits than a double.
+struct MandelDeepView {
+  std::string center_real = "-0.5";
+  std::string center_imag = "0";
+  double zoom = 1.0;
+
+  MandelView Approximate() const {
+    MandelView v;
+    v.center_real = std::stod(center_real);
+    v.center_imag = std::stod(center_imag);
+    v.zoom = zoom;
+    return v;
+  }
+};
+
+// Iteration count of C + dc against the reference orbit ref_re/ref_im
+// (ref_len points, Z_0 = 0); rebased is set when the pixel needed a rebase.
+template <class T>
+inline int MandelPerturbedIterations(const T *ref_re, const T *ref_im, int ref_len, T dcr, T dci,
+                                     int max_iterations, bool &rebased) {
+  T dzr = 0, dzi = 0;
+  int m = 0, count = 0;
+  for (int i = 0; i < max_iterations; ++i) {
+    const T zr = ref_re[m] + dzr, zi = ref_im[m] + dzi;
+    const T z2 = zr * zr + zi * zi;
+    // leave loop if diverging
+    if (z2 >= T(4)) break;
+    if (m == ref_len - 1 || z2 < dzr * dzr + dzi * dzi) {
+      dzr = zr;
+      dzi = zi;
+      m = 0;
+      rebased = true;
+    }
+    const T Zr = ref_re[m], Zi = ref_im[m];
+    const T nr = T(2) * (Zr * dzr - Zi * dzi) + (dzr * dzr - dzi * dzi) + dcr;
+    const T ni = T(2) * (Zr * dzi + Zi * dzr) + T(2) * dzr * dzi + dci;
+    dzr = nr;
+    dzi = ni;
+    m++;
+    count++;
+  }
+  return count;
+}
+
+class MandelPerturbation : public Mandel {
+public:
+  MandelPerturbation(int row_count, int col_count, int max_iterations, const MandelDeepView &view = MandelDeepView())
+    : Mandel(row_count, col_count, max_iterations, view.Approximate()), deep_view_(view) { }
+
+  void SetDeepView(const MandelDeepView &view, int max_iterations) {
+    SetView(view.Approximate(), max_iterations);
+    deep_view_ = view;
+    ref_re_.clear();
+  }
+
+  const MandelDeepView &GetDeepView() const { return deep_view_; }
+
+  // Fixed-point bits of the reference orbit, length of the orbit (shorter
+  // than max_iterations + 1 if the center escapes) and pixels rebased in
+  // the last evaluation.
+  int PrecisionBits() const { return 32 * (Limbs() - 1); }
+  int ReferenceLength() const { return (int)ref_re_.size(); }
+  long long Rebased() const { return rebased_; }
+  bool DeviceDouble() const { return device_double_; }
+
+  // Offsets in double when the device has fp64, float otherwise.
+  void Evaluate(queue &q) {
+    Reference();
+    device_double_ = q.get_device().has(aspect::fp64);
+    if (device_double_)
+      Run<double>(q);
+    else
+      Run<float>(q);
+  }
+
+  // The same iteration in double on all host cores, for checking Evaluate.
+  void EvaluateHost(int threads = 0) {
+    Reference();
+    MandelParameters p = GetParameters();
+    const int rows = p.row_count(), cols = p.col_count(), len = ReferenceLength();
+    const double step = Step();
+    int *out = data();
+    threads = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+
+    std::atomic<int> next{0};
+    std::atomic<long long> rebased{0};
+    auto work = [&]() {
+      long long local = 0;
+      for (int i; (i = next.fetch_add(1)) < rows;) {
+        for (int j = 0; j < cols; ++j) {
+          bool r = false;
+          out[(size_t)i * cols + j] = p.Map(MandelPerturbedIterations<double>(
+              ref_re_.data(), ref_im_.data(), len, (i - rows * 0.5) * step, (j - cols * 0.5) * step, p.max_iterations(), r));
+          local += r;
+        }
+      }
+      rebased += local;
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto &th : pool) th.join();
+    rebased_ = rebased;
+  }
+
+private:
+  // Distance between neighbouring pixels, as in MandelParameters
+  double Step() const {
+    MandelParameters p = GetParameters();
+    return 2.0 / (deep_view_.zoom * std::min(p.row_count(), p.col_count()));
+  }
+
+  // Enough fraction limbs for the pixel step plus 64 guard bits
+  int Limbs() const {
+    const double bits = std::max(0.0, -std::log2(Step())) + 64;
+    return 2 + (int)(bits / 32);
+  }
+
+  // Reference orbit of the view center, computed once per view
+  void Reference() {
+    if (!ref_re_.empty()) return;
+    const int limbs = Limbs();
+    const MandelBig cr = MandelBig::Parse(deep_view_.center_real, limbs);
+    const MandelBig ci = MandelBig::Parse(deep_view_.center_imag, limbs);
+    MandelBig zr(limbs), zi(limbs);
+    ref_re_.push_back(0.0);
+    ref_im_.push_back(0.0);
+    for (int n = 0; n < GetParameters().max_iterations(); ++n) {
+      const MandelBig rr = zr * zr, ii = zi * zi;
+      if ((rr + ii).ToDouble() >= 4.0) break;
+      const MandelBig ri = zr * zi;
+      zr = rr - ii + cr;
+      zi = ri + ri + ci;
+      ref_re_.push_back(zr.ToDouble());
+      ref_im_.push_back(zi.ToDouble());
+    }
+  }
+
+  template <class T>
+  void Run(queue &q) {
+    MandelParameters p = GetParameters();
+    const int rows = p.row_count(), cols = p.col_count(), len = ReferenceLength();
+    const T step = (T)Step();
+    const T half_rows = (T)(rows * 0.5), half_cols = (T)(cols * 0.5);
+    std::vector<T> re(ref_re_.begin(), ref_re_.end()), im(ref_im_.begin(), ref_im_.end());
+    int rebased = 0;
+    {
+      buffer<int, 2> data_buf(data(), range<2>(rows, cols));
+      buffer<T, 1> re_buf(re.data(), range<1>(len)), im_buf(im.data(), range<1>(len));
+      buffer<int, 1> rebased_buf(&rebased, range<1>(1));
+
+      q.submit([&](handler &h) {
+        auto b = data_buf.get_access<access::mode::write>(h);
+        auto ref_re = re_buf.template get_access<access::mode::read>(h);
+        auto ref_im = im_buf.template get_access<access::mode::read>(h);
+        auto count = reduction(rebased_buf, h, plus<int>());
+
+        h.parallel_for(range<2>(rows, cols), count, [=](id<2> index, auto &rebased_pixels) {
+          const int i = int(index[0]), j = int(index[1]);
+          bool r = false;
+          const int n = MandelPerturbedIterations<T>(
+              ref_re.template get_multi_ptr<access::decorated::no>().get(),
+              ref_im.template get_multi_ptr<access::decorated::no>().get(), len,
+              (T(i) - half_rows) * step, (T(j) - half_cols) * step, p.max_iterations(), r);
+          b[index] = p.Map(n);
+          rebased_pixels += r ? 1 : 0;
+        });
+      });
+    }
+    q.wait_and_throw();
+    rebased_ = rebased;
+  }
+
+  MandelDeepView deep_view_;
+  std::vector<double> ref_re_, ref_im_;
+  long long rebased_ = 0;
+  bool device_double_ = false;
+};
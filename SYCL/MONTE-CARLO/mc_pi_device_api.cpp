@@ -15,9 +15,10 @@
 #include <iostream>
 #include <numeric>
 #include <vector>
-#include <sys/time.h>
 #include <sycl/sycl.hpp>
 #include "oneapi/mkl/rng/device.hpp"
+#include "harness.hpp"
+#include "report.hpp"
 
 using namespace oneapi;
 
@@ -30,44 +31,6 @@ static const auto seed = 7777;
 // Default Number of 2D points
 static const auto n_samples = 120000000;
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 double estimate_pi(sycl::queue& q, size_t n_points) {
     double estimated_pi;         // Estimated value of Pi
     size_t n_under_curve = 0;    // Number of points fallen under the curve
@@ -120,11 +83,8 @@ int main(int argc, char ** argv) {
     std::cout << "Device Api" << std::endl;
     std::cout << "-------------------------------------" << std::endl;
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[10];
-    double Average = 0.0;
+    harness::Options opts = harness::Options::FromEnv(10);
+    harness::Series pi_time("mc_pi_device_api", opts);
     
     double estimated_pi;
     size_t n_points = n_samples;
@@ -135,7 +95,6 @@ int main(int argc, char ** argv) {
         }
     }
     std::cout << "Number of points = " << n_points << std::endl;
-    Calibrate(&ClkPerSec, NSecClk);
     // This exception handler with catch async exceptions
     auto exception_handler = [&](sycl::exception_list exceptions) {
         for(std::exception_ptr const& e : exceptions) {
@@ -148,16 +107,17 @@ int main(int argc, char ** argv) {
         }
     };
 
+    std::string device_name;
     try {
         // Queue constructor passed exception handler
         sycl::queue q(sycl::cpu_selector{}, exception_handler);
+        device_name = q.get_device().get_info<sycl::info::device::name>();
         // Launch Pi number calculation
-	for(int count = 0;count < 10; count++)
+	for(int count = 0; count < pi_time.iterations(); count++)
         {
-          start = rdtsc();
+          harness::Timer timer(opts.clock);
           estimated_pi = estimate_pi(q, n_points);
-          end = rdtsc();
-          elapsed_count[count] = (double)(end-start)/ClkPerSec;
+          pi_time.Record(timer.Elapsed());
         }
     } catch (...) {
         // Some other exception detected
@@ -169,11 +129,22 @@ int main(int argc, char ** argv) {
     std::cout << "Estimated value of Pi = " << estimated_pi << std::endl;
     std::cout << "Exact value of Pi = " << pi << std::endl;
     std::cout << "Absolute error = " << fabs(pi-estimated_pi) << std::endl;
-    for(int count=1;count<10;count++)
-        Average += elapsed_count[count];
+    printf("\nTime to compute Monte-Carlo output for pi = %0.12f \n",pi_time.Summary().mean);
+    pi_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "monte_carlo_pi";
+    run.variant = "mc_pi_device_api";
+    run.device = device_name;
+    run.memory = "none";
+    run.precision = "fp32";
+    run.sizes = {{"n_points", (long long)n_points}};
+    // length() of a 2D point: two multiplies, an add and a square root
+    run.flops = 4.0 * n_points;
+    // Random numbers are generated in registers; only the counter is touched in memory
+    run.bytes = 0.0;
+    harness::WriteRecords(run, pi_time);
 
-    Average = Average/(9);
-    printf("\nTime to compute Monte-Carlo output for pi = %0.12f \n",Average);
     std::cout << std::endl;
 
     return 0;
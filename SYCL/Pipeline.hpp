@@ -0,0 +1,170 @@
+//==============================================================
+// Chunked, double-buffered host <-> device streaming for the "dcopy"
+// drivers.
+//
+// The dcopy variants copy the whole input, compute, then copy the whole
+// output back, each step waiting for the previous one.  In streaming
+// mode the data is split into chunks that are dealt round-robin to
+// `depth` in-order queues on the same device.  Each queue owns one set of
+// device staging buffers (a "slot"), so the copy-in of chunk i+1, the
+// compute of chunk i and the copy-out of chunk i-1 run on different
+// queues at the same time, and device memory only has to hold `depth`
+// chunks rather than the whole working set.  In-order execution within a
+// queue is what makes reusing a slot for the next chunk safe.
+//
+// The queues are created with profiling enabled; Run() returns the wall
+// time of the pipeline and the summed device time of each stage, from
+// which the achieved overlap is reported.
+//
+// Drivers enable it with a trailing `stream [chunks] [depth]` argument.
+// Host arrays should come from malloc_host so the copies can run
+// asynchronously.
+// =============================================================
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "harness.hpp"
+
+namespace pipeline {
+
+struct Options {
+    bool enabled = false;
+    int chunks = 8;
+    int depth = 2;
+
+    // Looks for "stream [chunks] [depth]" in argv[first..argc).  Only
+    // numbers are taken as chunks and depth, so other trailing options
+    // may follow.
+    static Options FromArgs(int argc, char *argv[], int first)
+    {
+        auto number = [&](int i) { return i < argc && std::isdigit((unsigned char)argv[i][0]); };
+        Options opts;
+        for (int i = first; i < argc; i++) {
+            if (std::strcmp(argv[i], "stream") != 0)
+                continue;
+            opts.enabled = true;
+            if (number(i + 1)) {
+                opts.chunks = std::max(1, std::atoi(argv[i + 1]));
+                if (number(i + 2)) opts.depth = std::max(1, std::atoi(argv[i + 2]));
+            }
+            break;
+        }
+        return opts;
+    }
+};
+
+// [begin, end) of chunk c when n items are split into `chunks` near-equal pieces.
+inline std::pair<size_t, size_t> Chunk(size_t n, int chunks, int c)
+{
+    return {n * c / chunks, n * (c + 1) / chunks};
+}
+
+// Device time of e from its profiling info.  Returns false, leaving
+// seconds untouched, when e has none: library calls may return events
+// without profiling data even on a profiling queue.
+inline bool DeviceSeconds(const sycl::event &e, double &seconds)
+{
+    try {
+        seconds = 1e-9 * (e.get_profiling_info<sycl::info::event_profiling::command_end>() -
+                          e.get_profiling_info<sycl::info::event_profiling::command_start>());
+        return true;
+    } catch (const sycl::exception &) {
+        return false;
+    }
+}
+
+// Events of one chunk's three stages; any of them may hold several commands.
+struct Stage {
+    std::vector<sycl::event> in, compute, out;
+};
+
+struct Report {
+    double wall = 0.0;
+    double copy_in = 0.0, compute = 0.0, copy_out = 0.0;   // summed device time
+    bool profiled = false;
+
+    double Serial() const { return copy_in + compute + copy_out; }
+
+    // Fraction of the serialized stage time hidden behind other stages.
+    double Overlap() const { return (profiled && Serial() > 0.0) ? std::max(0.0, 1.0 - wall / Serial()) : 0.0; }
+
+    void Print(std::FILE *out = stdout) const
+    {
+        if (!profiled) {
+            std::fprintf(out, "Pipeline : wall %.6f s (device has no queue profiling, overlap unknown)\n", wall);
+            return;
+        }
+        std::fprintf(out, "Pipeline : wall %.6f s, copy-in %.6f s, compute %.6f s, copy-out %.6f s, overlap %.1f%%\n",
+                     wall, copy_in, compute, copy_out, 100.0 * Overlap());
+    }
+};
+
+class Streamer {
+ public:
+    Streamer(const sycl::queue &q, const Options &opts, harness::ClockKind clock = harness::ClockKind::steady)
+        : opts_(opts), clock_(clock), profiled_(q.get_device().has(sycl::aspect::queue_profiling))
+    {
+        sycl::property_list props = profiled_
+            ? sycl::property_list{sycl::property::queue::in_order(), sycl::property::queue::enable_profiling()}
+            : sycl::property_list{sycl::property::queue::in_order()};
+        for (int i = 0; i < opts.depth; i++)
+            queues_.emplace_back(q.get_context(), q.get_device(), props);
+    }
+
+    int depth() const { return opts_.depth; }
+    int chunks() const { return opts_.chunks; }
+    sycl::queue &queue(int slot) { return queues_[slot]; }
+
+    // body(queue, slot, chunk) enqueues one chunk on `queue`, using the
+    // staging buffers of `slot`, and returns the events of its stages.
+    template <class Body>
+    Report Run(Body &&body)
+    {
+        std::vector<Stage> stages;
+        stages.reserve(opts_.chunks);
+
+        harness::Timer timer(clock_);
+        for (int c = 0; c < opts_.chunks; c++) {
+            int slot = c % opts_.depth;
+            stages.push_back(body(queues_[slot], slot, c));
+        }
+        for (auto &q : queues_)
+            q.wait();
+
+        Report report;
+        report.wall = timer.Elapsed();
+        report.profiled = profiled_;
+        if (profiled_)
+            for (auto &s : stages) {
+                report.copy_in += Seconds(s.in);
+                report.compute += Seconds(s.compute);
+                report.copy_out += Seconds(s.out);
+            }
+        return report;
+    }
+
+ private:
+    static double Seconds(const std::vector<sycl::event> &events)
+    {
+        double total = 0.0, seconds;
+        for (auto &e : events)
+            if (DeviceSeconds(e, seconds))
+                total += seconds;
+        return total;
+    }
+
+    Options opts_;
+    harness::ClockKind clock_;
+    bool profiled_;
+    std::vector<sycl::queue> queues_;
+};
+
+}  // namespace pipeline
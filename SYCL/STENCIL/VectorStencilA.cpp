@@ -1,67 +1,36 @@
 #include <sycl/sycl.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include<sys/sysinfo.h>
-#include<sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
+#include "../Pipeline.hpp"
 //#include "tbb/tbb.h"
 
-#define INDEX(N,i,j) (i*N + j)
+// N rows of M columns, row-major
+#define INDEX(M,i,j) ((i)*(M) + (j))
 
 //using namespace hipsycl::sycl;
 using namespace sycl;
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc,char *argv[])
 {
     const int N=atoi(argv[3]),M=atoi(argv[4]);
     int index;
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end,end1;
-    double elapsed_count[10],Average = 0.0;
-
-    queue gpu_selector(gpu_selector_v);
-    queue cpu_selector(cpu_selector_v);
+    // Optional trailing "stream [chunks] [depth]" streams row blocks through the device
+    const pipeline::Options stream = pipeline::Options::FromArgs(argc, argv, 5);
+    harness::Options opts = harness::Options::FromEnv(atoi(argv[1]));
+    harness::Series stencil_time(stream.enabled ? "VectorStencilA stream" : "VectorStencilA", opts);
+    harness::Series transfer_time(stream.enabled ? "VectorStencilA stream transfer" : "VectorStencilA transfer", opts);
+
+    // Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
+    // In order: the copy-back kernel reads what the stencil kernel wrote
     queue q;
     if(strcmp(argv[2],"cpu") == 0)
-        q = cpu_selector;
+        q = queue(cpu_selector_v,property::queue::in_order());
     else
-        q = gpu_selector;
+        q = queue(gpu_selector_v,property::queue::in_order());
 
     //oneapi::tbb::task_group tg;
     //auto mp = tbb::global_control::max_allowed_parallelism;
@@ -72,7 +41,10 @@ int main(int argc,char *argv[])
     std::cout << "Max Compute Units : " << q.get_device().get_info<info::device::max_compute_units>() << std::endl;
 
     // Initialise Bordered-Array.
-    float *H_a = static_cast<float*>(malloc(N*M*sizeof(float)));
+    // Streaming needs pinned host memory, and a second grid since the
+    // halo rows of the next chunk must not be overwritten by the copy-out
+    float *H_a = stream.enabled ? malloc_host<float>(N*M,q) : static_cast<float*>(malloc(N*M*sizeof(float)));
+    float *H_b = stream.enabled ? malloc_host<float>(N*M,q) : nullptr;
     //float *FNorm = static_cast<float*>(malloc_shared(sizeof(float),q));
     //FNorm[0] = 0.0f;
 
@@ -82,6 +54,8 @@ int main(int argc,char *argv[])
             H_a[((i*N) + j)] = 1.0f;
             
     }
+    if(H_b)
+        std::copy(H_a,H_a + N*M,H_b);
 
     /*std::cout << "Original Square Domain : \n";
     for(int i=0;i<M;i++)
@@ -92,58 +66,84 @@ int main(int argc,char *argv[])
         std::cout << "\n";
     }*/
 
-    auto *D_a = static_cast<float*>(malloc_device<float>(N*M,q));
-    auto *D_Stencil = static_cast<float*>(malloc_device<float>((N-2)*(M-2),q));
-
-    Calibrate(&ClkPerSec,NSecClk);
-
-    for(int count = 0;count < atoi(argv[1]);count++)
-    {
-        //if(FNorm[0] == 0.0f)
-        //    FNorm[0] = 1.0f;
-        //else
-        //    FNorm[0] = 1.0f;
-        //for(int i=0;i<M;i++)
-        //{
-        //    for(int j=0;j<N;j++)
-        //        std::cout << H_a[(i*N) + j] << "\t";
-
-        //    std::cout << "\n";
-        //}
+    // When streaming the device holds one block of rows (plus halo) per pipeline slot
+    const int rows = (N - 2 + stream.chunks - 1) / stream.chunks;
+    auto *D_a = static_cast<float*>(malloc_device<float>(stream.enabled ? (size_t)(rows+2)*M*stream.depth : (size_t)N*M,q));
+    auto *D_Stencil = static_cast<float*>(malloc_device<float>(stream.enabled ? (size_t)rows*M*stream.depth : (size_t)(N-2)*(M-2),q));
 
-        start = rdtsc(); 
+    // One non-streamed pass over `grid` through the device arrays `in` (N x M)
+    // and `stencil` ((N-2) x (M-2)); returns the host to device copy time.
+    auto direct_pass = [&](float *grid, float *in, float *stencil) {
+        harness::Timer timer(opts.clock);
+        q.memcpy(in,grid,(sizeof(float)*N*M)).wait();
+        double transfer = timer.Elapsed();
 
-        q.memcpy(D_a,H_a,(sizeof(float)*N*M)).wait();
-	end1 = rdtsc();
-
-        // Kernel to compute the 5pt stencil and simultaneously the L2Norm
+        // Kernel to compute the 5pt stencil
         q.parallel_for(range<2>(N-2,M-2), [=](auto index){
             int row = index.get_id(0) + 1;
             int col = index.get_id(1) + 1;
 
-            D_Stencil[INDEX((N-2),(row-1),(col-1))] = (4*D_a[INDEX(N,row,col)] - D_a[INDEX(N,(row-1),col)] - D_a[INDEX(N,(row+1),col)] - D_a[INDEX(N,row,(col-1))] - D_a[INDEX(N,row,(col+1))]);
-            //FNorm[0] += (D_Stencil[INDEX((N-2),(row-1),(col-1))] * D_Stencil[INDEX((N-2),(row-1),(col-1))]);
+            stencil[INDEX((M-2),(row-1),(col-1))] = (4*in[INDEX(M,row,col)] - in[INDEX(M,(row-1),col)] - in[INDEX(M,(row+1),col)] - in[INDEX(M,row,(col-1))] - in[INDEX(M,row,(col+1))]);
         });
 
-        //printf("Frobenius Norm : %.12f\n",FNorm[0]);
-	//FNorm[0] = std::sqrt(FNorm[0]);
-        //printf("Frobenius Norm : %.12f\n",FNorm[0]);
-
-        // Kernel to scale the interior by (Stencil Updated Value / L2Norm)
-	q.parallel_for(range<2>(N-2,M-2), [=](auto index){
+        // Kernel to copy the stencil result back into the interior
+        q.parallel_for(range<2>(N-2,M-2), [=](auto index){
             int row = index.get_id(0) + 1;
             int col = index.get_id(1) + 1;
 
-            D_a[(row*N)+col] = (D_Stencil[INDEX((N-2),(row-1),(col-1))]);///FNorm[0]);
-        }).wait();
+            in[INDEX(M,row,col)] = stencil[INDEX((M-2),(row-1),(col-1))];
+        });
+
+        q.memcpy(grid,in,sizeof(float)*N*M).wait();
+        return transfer;
+    };
 
-        q.memcpy(H_a,D_a,sizeof(float)*N*M).wait();
-    
-        end = rdtsc();
-    
-        elapsed_count[count] = (double)(end - start)/ClkPerSec;
-        printf("TTC : %.12f\n",elapsed_count[count]);
-        printf("Transfer Time : %.12f\n", ((double)(end1-start)/ClkPerSec));
+    if(stream.enabled)
+    {
+        pipeline::Streamer streamer(q, stream, opts.clock);
+        pipeline::Report report;
+        for(int count = 0;count < stencil_time.iterations();count++)
+        {
+            // Interior rows [r0,r1) read rows r0-1..r1 of H_a and write the same rows of H_b
+            report = streamer.Run([&](queue &sq, int slot, int c) {
+                auto [begin, end] = pipeline::Chunk(N-2, stream.chunks, c);
+                const int r0 = 1 + begin, len = end - begin;
+                float *In = D_a + (size_t)slot*(rows+2)*M;
+                float *Out = D_Stencil + (size_t)slot*rows*M;
+
+                pipeline::Stage stage;
+                stage.in = {sq.memcpy(In,H_a + INDEX(M,(r0-1),0),sizeof(float)*(len+2)*M)};
+                stage.compute = {sq.parallel_for(range<2>(len,M), [=](auto index){
+                    int row = index.get_id(0) + 1;   // row in the staged block
+                    int col = index.get_id(1);
+
+                    Out[INDEX(M,(row-1),col)] = (col == 0 || col == M-1) ? In[INDEX(M,row,col)]
+                        : (4*In[INDEX(M,row,col)] - In[INDEX(M,(row-1),col)] - In[INDEX(M,(row+1),col)] - In[INDEX(M,row,(col-1))] - In[INDEX(M,row,(col+1))]);
+                })};
+                stage.out = {sq.memcpy(H_b + INDEX(M,r0,0),Out,sizeof(float)*len*M)};
+                return stage;
+            });
+            std::swap(H_a,H_b);
+
+            stencil_time.Record(report.wall);
+            transfer_time.Record(report.copy_in + report.copy_out);
+            printf("TTC : %.12f\n",report.wall);
+        }
+        report.Print();
+    }
+    else
+    {
+        for(int count = 0;count < stencil_time.iterations();count++)
+        {
+            harness::Timer timer(opts.clock);
+            double transfer = direct_pass(H_a,D_a,D_Stencil);
+            transfer_time.Record(transfer);
+
+            double ttc = timer.Elapsed();
+            stencil_time.Record(ttc);
+            printf("TTC : %.12f\n",ttc);
+            printf("Transfer Time : %.12f\n", transfer);
+        }
     }
 
     // Print updated Vector1 after Sum
@@ -157,15 +157,71 @@ int main(int argc,char *argv[])
     //}
 
 
-    for(int count=1;count<(atoi(argv[1]));count++)
-        Average += elapsed_count[count];
-   
-    std::cout << "\nTime to compute 5pt-Stencil + Power Method (Total) = " << Average << "\n"; 
-    Average = Average/(atoi(argv[1]) - 1);
-    std::cout << "\nTime to compute (Avg over " << atoi(argv[1]) << " loops) = " << Average << "\n";
+    harness::Stats stats = stencil_time.Summary();
+    std::cout << "\nTime to compute 5pt-Stencil + Power Method (Total) = " << stats.mean * stats.count << "\n";
+    std::cout << "\nTime to compute (Avg over " << stats.count << " loops) = " << stats.mean << "\n";
+    stencil_time.Print();
+    transfer_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "stencil";
+    run.variant = stream.enabled ? "VectorStencilA_stream" : "VectorStencilA";
+    run.device = q.get_device().get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp32";
+    run.sizes = {{"n", N}, {"m", M}};
+    run.flops = 5.0 * (N-2) * (M-2);
+    // Host to device copy, stencil, copy-back kernel and device to host copy
+    run.bytes = 6.0 * N * M * sizeof(float);
+    if(stream.enabled)
+    {
+        // Copy-in, stencil read and write, copy-out; no copy-back kernel
+        run.bytes = 4.0 * N * M * sizeof(float);
+        run.sizes.push_back({"chunks", stream.chunks});
+        run.sizes.push_back({"depth", stream.depth});
+    }
+    harness::WriteRecords(run, stencil_time);
+
+    run.flops = 0.0;
+    run.bytes = (double)N * M * sizeof(float);
+    harness::WriteRecords(run, transfer_time);
+
+    // The streamed grid has to match the same number of non-streamed passes
+    // from the initial grid, run on full-size device arrays
+    int status = 0;
+    if(stream.enabled)
+    {
+        std::vector<float> H_ref((size_t)N*M,1.0f);
+        float *D_full = malloc_device<float>((size_t)N*M,q);
+        float *D_full_stencil = malloc_device<float>((size_t)(N-2)*(M-2),q);
+        for(int count = 0;count < stencil_time.iterations();count++)
+            direct_pass(H_ref.data(),D_full,D_full_stencil);
+        free(D_full,q);
+        free(D_full_stencil,q);
+
+        size_t wrong = 0;
+        for(size_t i=0;i<H_ref.size();i++)
+        {
+            const float a = H_a[i], b = H_ref[i];
+            // Long runs overflow; both paths then have to agree on inf/nan
+            const bool same = std::isfinite(a) && std::isfinite(b)
+                ? std::fabs(a-b) <= 1e-5f*std::max(1.0f,std::max(std::fabs(a),std::fabs(b)))
+                : (std::isnan(a) && std::isnan(b)) || a == b;
+            wrong += !same;
+        }
+        status = wrong == 0 ? 0 : 1;
+        wrong == 0 ? std::cout << "Verified: streamed grid matches the non-streamed passes\n"
+                   : std::cout << "Failed: " << wrong << " entries of the streamed grid differ from the non-streamed passes\n";
+    }
 
     free(D_a,q);
     free(D_Stencil,q);
+    if(stream.enabled)
+    {
+        free(H_a,q);
+        free(H_b,q);
+    }
     //free(H_a);
     //free(FNorm,q);
+    return status;
 }
@@ -1,6 +1,7 @@
 #include <sycl/sycl.hpp>
 #include<sys/sysinfo.h>
-#include<sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
 //#include "tbb/tbb.h"
 
 #define INDEX(N,i,j) (i*N + j)
@@ -8,62 +9,21 @@
 //using namespace hipsycl::sycl;
 using namespace sycl;
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc,char *argv[])
 {
     const int N=atoi(argv[3]),M=atoi(argv[4]);
     int index;
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[10],Average = 0.0;
+    harness::Options opts = harness::Options::FromEnv(atoi(argv[1]));
+    harness::Series stencil_time("VectorStencilC_async", opts);
     float FNorm = 0.0;
 
 
-    queue cpu_selector(cpu_selector_v);
-    queue gpu_selector(gpu_selector_v);
+    // Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
     queue q;
     if(strcmp(argv[2],"cpu") == 0)
-        q = cpu_selector;
+        q = queue(cpu_selector_v);
     else
-        q = gpu_selector;
+        q = queue(gpu_selector_v);
 
     //oneapi::tbb::task_group tg;
     //auto mp = tbb::global_control::max_allowed_parallelism;
@@ -92,11 +52,9 @@ int main(int argc,char *argv[])
     buffer<float,2> Buf_b(Mat_Stencil.data(),range<2>(N,M));
     buffer<float,1> Buf_Fn(&FNorm, range<1>(1));
 
-    Calibrate(&ClkPerSec,NSecClk);
-
-    for(int count = 0;count < atoi(argv[1]);count++)
+    for(int count = 0;count < stencil_time.iterations();count++)
     {
-        start = rdtsc();
+        harness::Timer timer(opts.clock);
         if(FNorm == 0.0f)
           FNorm = 1.0f;
         else
@@ -157,10 +115,9 @@ int main(int argc,char *argv[])
             });
         });
         e3.wait();
-        end = rdtsc();
-    
-        elapsed_count[count] = (double)(end - start)/ClkPerSec;
-        printf("TTC : %.12f\n",elapsed_count[count]);
+        double ttc = timer.Elapsed();
+        stencil_time.Record(ttc);
+        printf("TTC : %.12f\n",ttc);
     }
 
     // Print updated Vector1 after Sum
@@ -178,12 +135,22 @@ int main(int argc,char *argv[])
     
 
 
-    for(int count=1;count<(atoi(argv[1]));count++)
-        Average += elapsed_count[count];
-   
-    std::cout << "\nTime to compute 5pt-Stencil + Power Method (Total) = " << Average << "\n"; 
-    Average = Average/(atoi(argv[1]) -1);
-    std::cout << "\nTime to compute (Avg over " << atoi(argv[1]) << " loops) = " << Average << "\n";
+    harness::Stats stats = stencil_time.Summary();
+    std::cout << "\nTime to compute 5pt-Stencil + Power Method (Total) = " << stats.mean * stats.count << "\n";
+    std::cout << "\nTime to compute (Avg over " << stats.count << " loops) = " << stats.mean << "\n";
+    stencil_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "stencil";
+    run.variant = "VectorStencilC_async";
+    run.device = q.get_device().get_info<info::device::name>();
+    run.memory = "buffer";
+    run.precision = "fp32";
+    run.sizes = {{"n", N}, {"m", M}};
+    run.flops = 8.0 * (N-2) * (M-2);
+    // Stencil, separate norm reduction over Mat_Stencil, then the normalize pass
+    run.bytes = 5.0 * N * M * sizeof(float);
+    harness::WriteRecords(run, stencil_time);
 
     //free(Mat_A,q);
     //free(Mat_Stencil,q);
@@ -0,0 +1,189 @@
+#include <sycl/sycl.hpp>
+#include<sys/sysinfo.h>
+#include <cmath>
+#include <vector>
+#include "harness.hpp"
+#include "report.hpp"
+
+// Fused power-method step for the 5pt stencil.
+//
+// VectorStencilA/B/C make three or four passes per iteration: stencil into
+// Mat_Stencil, a reduction over it, a sqrt, and a normalize pass reading
+// Mat_Stencil back.  Here one nd_range kernel per iteration reads the
+// previous (unnormalized) grid, applies the previous iteration's 1/norm as
+// a scale factor while loading, writes the new unnormalized grid and
+// reduces its squared norm per work-group.  That is one read and one
+// write sweep per iteration instead of about five.
+//
+// The squared norms rotate through three slots: iteration k reads slot
+// k-1, accumulates into slot k and clears slot k+1 for the next launch,
+// so no separate reset or sqrt kernel is needed.
+//
+// Usage: VectorStencilFused <iterations> <cpu|gpu> <N> <M> [verify]
+
+#define INDEX(M,i,j) ((i)*(M) + (j))
+
+//using namespace hipsycl::sycl;
+using namespace sycl;
+
+constexpr int TILE_ROWS = 16;
+constexpr int TILE_COLS = 16;
+
+// Unfused host power method with the same boundary handling, used by verify.
+static void HostReference(std::vector<float> &A, int N, int M, int iterations)
+{
+    std::vector<float> S((size_t)N*M);
+    for(int count=0;count<iterations;count++)
+    {
+        double norm = 0.0;
+        for(int row=1;row<N-1;row++)
+            for(int col=1;col<M-1;col++)
+            {
+                float v = 4*A[INDEX(M,row,col)] - A[INDEX(M,row-1,col)] - A[INDEX(M,row+1,col)] - A[INDEX(M,row,col-1)] - A[INDEX(M,row,col+1)];
+                S[INDEX(M,row,col)] = v;
+                norm += (double)v*v;
+            }
+        float inv = 1.0f/std::sqrt((float)norm);
+        for(int row=1;row<N-1;row++)
+            for(int col=1;col<M-1;col++)
+                A[INDEX(M,row,col)] = S[INDEX(M,row,col)]*inv;
+    }
+}
+
+int main(int argc,char *argv[])
+{
+    if(argc < 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " <iterations> <cpu|gpu> <N> <M> [verify]\n";
+        return 1;
+    }
+    const int N=atoi(argv[3]),M=atoi(argv[4]);
+    const bool verify = argc > 5 && strcmp(argv[5],"verify") == 0;
+    if(N < 3 || M < 3)
+    {
+        std::cerr << "N and M must be at least 3\n";
+        return 1;
+    }
+    harness::Options opts = harness::Options::FromEnv(atoi(argv[1]));
+    harness::Series stencil_time("VectorStencilFused", opts);
+
+    // Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
+    // In order: the uploads, the fused launches and the copy back run in submission order
+    queue q;
+    if(strcmp(argv[2],"cpu") == 0)
+        q = queue(cpu_selector_v,property::queue::in_order());
+    else
+        q = queue(gpu_selector_v,property::queue::in_order());
+
+    std::cout << "Device : " << q.get_device().get_info<info::device::name>() << "\n";
+    std::cout << "Max Compute Units : " << q.get_device().get_info<info::device::max_compute_units>() << std::endl;
+
+    std::vector<float> H_a((size_t)N*M,1.0f);
+
+    // Ping-pong grids; both carry the fixed boundary, only the interior is written.
+    float *D_in  = malloc_device<float>((size_t)N*M,q);
+    float *D_out = malloc_device<float>((size_t)N*M,q);
+    float *Norm2 = malloc_device<float>(3,q);
+    q.memcpy(D_in,H_a.data(),sizeof(float)*N*M);
+    q.memcpy(D_out,H_a.data(),sizeof(float)*N*M);
+    // Slot 2 is "iteration -1": a squared norm of 1 leaves the input unscaled.
+    const float init_norm2[3] = {0.0f, 0.0f, 1.0f};
+    q.memcpy(Norm2,init_norm2,sizeof(init_norm2)).wait();
+
+    const range<2> local(TILE_ROWS,TILE_COLS);
+    const range<2> global(((N-2+TILE_ROWS-1)/TILE_ROWS)*TILE_ROWS, ((M-2+TILE_COLS-1)/TILE_COLS)*TILE_COLS);
+
+    int slot = 0;
+    for(int count = 0;count < stencil_time.iterations();count++)
+    {
+        const int prev = (slot+2)%3, next = (slot+1)%3, cur = slot;
+        const float *In = D_in;
+        float *Out = D_out;
+
+        harness::Timer timer(opts.clock);
+
+        q.parallel_for(nd_range<2>(global,local), [=](nd_item<2> it){
+            int row = it.get_global_id(0) + 1;
+            int col = it.get_global_id(1) + 1;
+
+            if(it.get_global_linear_id() == 0)
+                Norm2[next] = 0.0f;
+
+            // Deferred normalize of the previous iteration, boundary stays unscaled
+            const float scale = sycl::rsqrt(Norm2[prev]);
+            auto A = [=](int r, int c) {
+                float v = In[INDEX(M,r,c)];
+                return (r == 0 || r == N-1 || c == 0 || c == M-1) ? v : scale*v;
+            };
+
+            float sq = 0.0f;
+            if(row < N-1 && col < M-1)
+            {
+                float stencil_value = 4*A(row,col) - A(row-1,col) - A(row+1,col) - A(row,col-1) - A(row,col+1);
+                Out[INDEX(M,row,col)] = stencil_value;
+                sq = stencil_value*stencil_value;
+            }
+
+            float partial = reduce_over_group(it.get_group(), sq, plus<float>());
+            if(it.get_local_linear_id() == 0)
+            {
+                atomic_ref<float, memory_order::relaxed, memory_scope::device, access::address_space::global_space> norm(Norm2[cur]);
+                norm.fetch_add(partial);
+            }
+        }).wait();
+
+        double ttc = timer.Elapsed();
+        stencil_time.Record(ttc);
+        printf("TTC : %.12f\n",ttc);
+
+        std::swap(D_in,D_out);
+        slot = next;
+    }
+
+    // Apply the last deferred normalize while copying back.
+    float last_norm2[3];
+    q.memcpy(H_a.data(),D_in,sizeof(float)*N*M);
+    q.memcpy(last_norm2,Norm2,sizeof(last_norm2)).wait();
+    const float inv = 1.0f/std::sqrt(last_norm2[(slot+2)%3]);
+    for(int row=1;row<N-1;row++)
+        for(int col=1;col<M-1;col++)
+            H_a[INDEX(M,row,col)] *= inv;
+
+    harness::Stats stats = stencil_time.Summary();
+    std::cout << "\nTime to compute 5pt-Stencil + Power Method (Total) = " << stats.mean * stats.count << "\n";
+    std::cout << "\nTime to compute (Avg over " << stats.count << " loops) = " << stats.mean << "\n";
+    stencil_time.Print();
+
+    int status = 0;
+    if(verify)
+    {
+        std::vector<float> R((size_t)N*M,1.0f);
+        HostReference(R,N,M,stencil_time.iterations());
+        double max_err = 0.0, max_ref = 0.0;
+        for(size_t i=0;i<R.size();i++)
+        {
+            max_err = std::max(max_err,(double)std::fabs(H_a[i]-R[i]));
+            max_ref = std::max(max_ref,(double)std::fabs(R[i]));
+        }
+        double rel = max_err/max_ref;
+        std::cout << "Verify against unfused host reference : max rel error = " << rel << (rel < 1e-3 ? " (PASS)\n" : " (FAIL)\n");
+        status = rel < 1e-3 ? 0 : 1;
+    }
+
+    harness::RunInfo run;
+    run.kernel = "stencil";
+    run.variant = "VectorStencilFused";
+    run.device = q.get_device().get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp32";
+    run.sizes = {{"n", N}, {"m", M}};
+    run.flops = 8.0 * (N-2) * (M-2);
+    // One read sweep of the previous grid and one write sweep of the new one
+    run.bytes = 2.0 * N * M * sizeof(float);
+    harness::WriteRecords(run, stencil_time);
+
+    free(D_in,q);
+    free(D_out,q);
+    free(Norm2,q);
+    return status;
+}
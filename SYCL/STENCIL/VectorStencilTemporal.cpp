@@ -0,0 +1,221 @@
+#include <sycl/sycl.hpp>
+#include<sys/sysinfo.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "harness.hpp"
+#include "report.hpp"
+
+// Temporally blocked 5pt stencil (unnormalized).
+//
+// The per-step kernels launch one sweep over range<2>(N-2,M-2) per step,
+// so every step streams the whole grid through DRAM.  Here each
+// work-group loads a TILE x TILE block plus a halo of width T into local
+// memory, advances it T steps there and writes the block back once.  The
+// halo shrinks by one cell per step; the redundant halo work is the price
+// for touching global memory once per T steps instead of every step.
+//
+// Each timed repetition runs <steps> steps from the same initial grid.
+// With "verify" the same steps are also run with the per-step kernel and
+// the two results are compared.  Values grow by up to 8x per step, so
+// keep <steps> small enough for fp32.
+//
+// Usage: VectorStencilTemporal <iterations> <cpu|gpu> <N> <M> <steps> <T> [verify]
+
+#define INDEX(M,i,j) ((i)*(M) + (j))
+
+//using namespace hipsycl::sycl;
+using namespace sycl;
+
+constexpr int TILE = 16;
+
+// Advance `tsteps` steps from In to Out; the boundary of Out must already hold the fixed values.
+static event TemporalStep(queue &q, const float *In, float *Out, int N, int M, int tsteps)
+{
+    const int E = TILE + 2*tsteps;
+    const range<2> local(TILE,TILE);
+    const range<2> global(((N-2+TILE-1)/TILE)*TILE, ((M-2+TILE-1)/TILE)*TILE);
+
+    return q.submit([&](handler &h)
+    {
+        // Two E x E planes, ping-ponged between steps
+        local_accessor<float,1> L(range<1>(2*E*E), h);
+
+        h.parallel_for(nd_range<2>(global,local), [=](nd_item<2> it){
+            const int row0 = 1 + it.get_group(0)*TILE - tsteps;
+            const int col0 = 1 + it.get_group(1)*TILE - tsteps;
+            const int lid = it.get_local_linear_id();
+            const int nthreads = TILE*TILE;
+
+            // Cooperative load of the tile and its halo; cells outside the grid are never used.
+            for(int i=lid;i<E*E;i+=nthreads)
+            {
+                int r = row0 + i/E, c = col0 + i%E;
+                L[i] = (r >= 0 && r < N && c >= 0 && c < M) ? In[INDEX(M,r,c)] : 0.0f;
+            }
+            group_barrier(it.get_group());
+
+            for(int t=1;t<=tsteps;t++)
+            {
+                const int src = ((t-1)%2)*E*E, dst = (t%2)*E*E;
+                for(int i=lid;i<E*E;i+=nthreads)
+                {
+                    int lr = i/E, lc = i%E;
+                    int r = row0 + lr, c = col0 + lc;
+                    // After t steps only cells at least t away from the halo edge are valid.
+                    bool valid = lr >= t && lr < E-t && lc >= t && lc < E-t;
+                    bool interior = r >= 1 && r < N-1 && c >= 1 && c < M-1;
+                    L[dst+i] = (valid && interior)
+                        ? (4*L[src+i] - L[src+i-E] - L[src+i+E] - L[src+i-1] - L[src+i+1])
+                        : L[src+i];
+                }
+                group_barrier(it.get_group());
+            }
+
+            const int lr = tsteps + it.get_local_id(0), lc = tsteps + it.get_local_id(1);
+            const int r = row0 + lr, c = col0 + lc;
+            if(r < N-1 && c < M-1)
+                Out[INDEX(M,r,c)] = L[(tsteps%2)*E*E + lr*E + lc];
+        });
+    });
+}
+
+// One step with the plain range<2> kernel of the other STENCIL variants.
+static event PerStep(queue &q, const float *In, float *Out, int N, int M)
+{
+    return q.parallel_for(range<2>(N-2,M-2), [=](auto index){
+        int row = index.get_id(0) + 1;
+        int col = index.get_id(1) + 1;
+
+        Out[INDEX(M,row,col)] = (4*In[INDEX(M,row,col)] - In[INDEX(M,(row-1),col)] - In[INDEX(M,(row+1),col)] - In[INDEX(M,row,(col-1))] - In[INDEX(M,row,(col+1))]);
+    });
+}
+
+int main(int argc,char *argv[])
+{
+    if(argc < 7)
+    {
+        std::cerr << "Usage: " << argv[0] << " <iterations> <cpu|gpu> <N> <M> <steps> <T> [verify]\n";
+        return 1;
+    }
+    const int N=atoi(argv[3]),M=atoi(argv[4]);
+    const int steps=atoi(argv[5]),T=atoi(argv[6]);
+    const bool verify = argc > 7 && strcmp(argv[7],"verify") == 0;
+    if(N < 3 || M < 3 || steps < 1 || T < 1)
+    {
+        std::cerr << "N and M must be at least 3, steps and T at least 1\n";
+        return 1;
+    }
+    harness::Options opts = harness::Options::FromEnv(atoi(argv[1]));
+    harness::Series stencil_time("VectorStencilTemporal", opts);
+    harness::Series perstep_time("VectorStencilTemporal per-step", opts);
+
+    // Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
+    // In order: every launch reads the grid the previous launch wrote
+    queue q;
+    if(strcmp(argv[2],"cpu") == 0)
+        q = queue(cpu_selector_v,property::queue::in_order());
+    else
+        q = queue(gpu_selector_v,property::queue::in_order());
+
+    std::cout << "Device : " << q.get_device().get_info<info::device::name>() << "\n";
+    std::cout << "Max Compute Units : " << q.get_device().get_info<info::device::max_compute_units>() << std::endl;
+
+    // Each work-group holds two (TILE+2T)^2 tiles of floats in local memory
+    const size_t local_mem = q.get_device().get_info<info::device::local_mem_size>();
+    const size_t E = TILE + 2*(size_t)std::min(T,steps);
+    if(2*E*E*sizeof(float) > local_mem)
+    {
+        std::cerr << "T = " << T << " needs " << 2*E*E*sizeof(float) << " bytes of local memory, "
+                  << local_mem << " on this device\n";
+        return 1;
+    }
+    std::cout << "Steps : " << steps << ", temporal block T = " << T << " (" << (steps+T-1)/T << " launches)\n";
+
+    std::vector<float> H_a((size_t)N*M);
+    for(size_t i=0;i<H_a.size();i++)
+        H_a[i] = (float)((i*37)%101)/101.0f;
+
+    float *D_a = malloc_device<float>((size_t)N*M,q);
+    float *D_b = malloc_device<float>((size_t)N*M,q);
+
+    // Runs `steps` steps from the initial grid (reset untimed) and returns the array holding the result.
+    auto run_steps = [&](bool temporal, harness::Series &series) {
+        q.memcpy(D_a,H_a.data(),sizeof(float)*N*M);
+        q.memcpy(D_b,H_a.data(),sizeof(float)*N*M).wait();
+
+        float *in = D_a, *out = D_b;
+        harness::Timer timer(opts.clock);
+        for(int done=0;done<steps;)
+        {
+            int tsteps = temporal ? std::min(T,steps-done) : 1;
+            if(temporal)
+                TemporalStep(q,in,out,N,M,tsteps);
+            else
+                PerStep(q,in,out,N,M);
+            std::swap(in,out);
+            done += tsteps;
+        }
+        q.wait();
+        double ttc = timer.Elapsed();
+        series.Record(ttc);
+        printf("TTC : %.12f\n",ttc);
+        return in;
+    };
+
+    float *result = nullptr;
+    for(int count = 0;count < stencil_time.iterations();count++)
+        result = run_steps(true,stencil_time);
+
+    std::vector<float> H_temporal((size_t)N*M);
+    q.memcpy(H_temporal.data(),result,sizeof(float)*N*M).wait();
+
+    harness::Stats stats = stencil_time.Summary();
+    std::cout << "\nTime to compute " << steps << " 5pt-Stencil steps (Avg over " << stats.count << " loops) = " << stats.mean << "\n";
+    stencil_time.Print();
+
+    int status = 0;
+    if(verify)
+    {
+        for(int count = 0;count < perstep_time.iterations();count++)
+            result = run_steps(false,perstep_time);
+
+        std::vector<float> H_ref((size_t)N*M);
+        q.memcpy(H_ref.data(),result,sizeof(float)*N*M).wait();
+        perstep_time.Print();
+
+        double max_err = 0.0, max_ref = 0.0;
+        for(size_t i=0;i<H_ref.size();i++)
+        {
+            max_err = std::max(max_err,(double)std::fabs(H_temporal[i]-H_ref[i]));
+            max_ref = std::max(max_ref,(double)std::fabs(H_ref[i]));
+        }
+        double rel = max_ref > 0.0 ? max_err/max_ref : max_err;
+        bool pass = std::isfinite(rel) && rel < 1e-5;
+        std::cout << "Verify against per-step kernel : max rel error = " << rel << (pass ? " (PASS)\n" : " (FAIL)\n");
+        status = pass ? 0 : 1;
+    }
+
+    harness::RunInfo run;
+    run.kernel = "stencil";
+    run.variant = "VectorStencilTemporal";
+    run.device = q.get_device().get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp32";
+    run.sizes = {{"n", N}, {"m", M}, {"steps", steps}, {"t", T}};
+    run.flops = 5.0 * (N-2) * (M-2) * steps;
+    // One read and one write sweep per launch, halo overlap not counted
+    run.bytes = 2.0 * N * M * sizeof(float) * ((steps+T-1)/T);
+    harness::WriteRecords(run, stencil_time);
+
+    if(verify)
+    {
+        run.variant = "VectorStencilTemporal per-step";
+        run.bytes = 2.0 * N * M * sizeof(float) * steps;
+        harness::WriteRecords(run, perstep_time);
+    }
+
+    free(D_a,q);
+    free(D_b,q);
+    return status;
+}
@@ -0,0 +1,181 @@
+#include <sycl/sycl.hpp>
+#include<sys/sysinfo.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "harness.hpp"
+#include "report.hpp"
+
+// nd_range 5pt stencil with local-memory halos.
+//
+// The other STENCIL variants use a plain range<2> and read all five
+// points of every update from global memory.  Here a B x B work-group
+// first stages its (B+2) x (B+2) tile into a local_accessor with
+// cooperative loads (halo included), then every work-item reads its
+// neighbours from local memory.  Each timed repetition runs one stencil
+// sweep with the naive kernel and one with the tiled kernel so the two
+// can be compared; the outputs are checked to be identical.
+//
+// The tile edge is a template parameter: 8, 16 and 32 are compiled in
+// (STENCIL_TILE picks the default at build time), any other value given
+// at run time uses the same kernel with a runtime-sized tile.
+//
+// Usage: VectorStencilTiled <iterations> <cpu|gpu> <N> <M> [B]
+
+#ifndef STENCIL_TILE
+#define STENCIL_TILE 16
+#endif
+
+#define INDEX(M,i,j) ((i)*(M) + (j))
+
+//using namespace hipsycl::sycl;
+using namespace sycl;
+
+// B > 0 fixes the tile edge at compile time, B == 0 takes it from `tile`.
+template <int B>
+static event TiledStencil(queue &q, const float *In, float *Out, int N, int M, int tile)
+{
+    const int b = B > 0 ? B : tile;
+    const range<2> local(b,b);
+    const range<2> global(((N-2+b-1)/b)*b, ((M-2+b-1)/b)*b);
+
+    return q.submit([&](handler &h)
+    {
+        local_accessor<float,1> L(range<1>((b+2)*(b+2)), h);
+
+        h.parallel_for(nd_range<2>(global,local), [=](nd_item<2> it){
+            const int tb = B > 0 ? B : b;
+            const int E = tb + 2;
+            const int row0 = it.get_group(0)*tb;   // global row of local row 0 (halo)
+            const int col0 = it.get_group(1)*tb;
+
+            // Cooperative load of the tile and its one-cell halo
+            for(int i=it.get_local_linear_id();i<E*E;i+=tb*tb)
+            {
+                int r = row0 + i/E, c = col0 + i%E;
+                L[i] = (r < N && c < M) ? In[INDEX(M,r,c)] : 0.0f;
+            }
+            group_barrier(it.get_group());
+
+            const int lr = it.get_local_id(0) + 1, lc = it.get_local_id(1) + 1;
+            const int row = row0 + lr, col = col0 + lc;
+            if(row < N-1 && col < M-1)
+                Out[INDEX(M,row,col)] = (4*L[lr*E+lc] - L[(lr-1)*E+lc] - L[(lr+1)*E+lc] - L[lr*E+lc-1] - L[lr*E+lc+1]);
+        });
+    });
+}
+
+// The plain range<2> kernel of the other STENCIL variants.
+static event NaiveStencil(queue &q, const float *In, float *Out, int N, int M)
+{
+    return q.parallel_for(range<2>(N-2,M-2), [=](auto index){
+        int row = index.get_id(0) + 1;
+        int col = index.get_id(1) + 1;
+
+        Out[INDEX(M,row,col)] = (4*In[INDEX(M,row,col)] - In[INDEX(M,(row-1),col)] - In[INDEX(M,(row+1),col)] - In[INDEX(M,row,(col-1))] - In[INDEX(M,row,(col+1))]);
+    });
+}
+
+static event Tiled(queue &q, const float *In, float *Out, int N, int M, int tile)
+{
+    switch(tile)
+    {
+        case 8:  return TiledStencil<8>(q,In,Out,N,M,tile);
+        case 16: return TiledStencil<16>(q,In,Out,N,M,tile);
+        case 32: return TiledStencil<32>(q,In,Out,N,M,tile);
+        default: return TiledStencil<0>(q,In,Out,N,M,tile);
+    }
+}
+
+int main(int argc,char *argv[])
+{
+    if(argc < 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " <iterations> <cpu|gpu> <N> <M> [B]\n";
+        return 1;
+    }
+    const int N=atoi(argv[3]),M=atoi(argv[4]);
+    const int tile = argc > 5 ? atoi(argv[5]) : STENCIL_TILE;
+    harness::Options opts = harness::Options::FromEnv(atoi(argv[1]));
+    harness::Series naive_time("VectorStencilTiled naive", opts);
+    harness::Series tiled_time("VectorStencilTiled B=" + std::to_string(tile), opts);
+
+    // Only construct the requested queue: gpu_selector_v throws on hosts without a GPU
+    // In order: the upload and the clears finish before the kernels, the kernels before the copies
+    queue q;
+    if(strcmp(argv[2],"cpu") == 0)
+        q = queue(cpu_selector_v,property::queue::in_order());
+    else
+        q = queue(gpu_selector_v,property::queue::in_order());
+
+    std::cout << "Device : " << q.get_device().get_info<info::device::name>() << "\n";
+    std::cout << "Max Compute Units : " << q.get_device().get_info<info::device::max_compute_units>() << std::endl;
+
+    const size_t max_wg = q.get_device().get_info<info::device::max_work_group_size>();
+    if(N < 3 || M < 3 || tile < 1 || (size_t)tile*tile > max_wg)
+    {
+        std::cerr << "N and M must be at least 3 and B*B at most " << max_wg << " on this device\n";
+        return 1;
+    }
+    std::cout << "Tile : " << tile << "x" << tile << ((tile == 8 || tile == 16 || tile == 32) ? " (compile time)\n" : " (run time)\n");
+
+    std::vector<float> H_a((size_t)N*M);
+    for(size_t i=0;i<H_a.size();i++)
+        H_a[i] = (float)((i*37)%101)/101.0f;
+
+    float *D_a     = malloc_device<float>((size_t)N*M,q);
+    float *D_naive = malloc_device<float>((size_t)N*M,q);
+    float *D_tiled = malloc_device<float>((size_t)N*M,q);
+    q.memcpy(D_a,H_a.data(),sizeof(float)*N*M);
+    q.memset(D_naive,0,sizeof(float)*N*M);
+    q.memset(D_tiled,0,sizeof(float)*N*M).wait();
+
+    for(int count = 0;count < tiled_time.iterations();count++)
+    {
+        harness::Timer timer(opts.clock);
+        NaiveStencil(q,D_a,D_naive,N,M).wait();
+        double naive = timer.Elapsed();
+        naive_time.Record(naive);
+
+        timer.Start();
+        Tiled(q,D_a,D_tiled,N,M,tile).wait();
+        double ttc = timer.Elapsed();
+        tiled_time.Record(ttc);
+        printf("TTC : naive %.12f tiled %.12f\n",naive,ttc);
+    }
+
+    std::vector<float> H_naive((size_t)N*M), H_tiled((size_t)N*M);
+    q.memcpy(H_naive.data(),D_naive,sizeof(float)*N*M);
+    q.memcpy(H_tiled.data(),D_tiled,sizeof(float)*N*M).wait();
+    double max_err = 0.0;
+    for(size_t i=0;i<H_naive.size();i++)
+        max_err = std::max(max_err,(double)std::fabs(H_naive[i]-H_tiled[i]));
+    std::cout << "Tiled vs naive max abs difference = " << max_err << (max_err < 1e-5 ? " (PASS)\n" : " (FAIL)\n");
+
+    std::cout << "\nTime to compute 5pt-Stencil (Avg over " << tiled_time.Summary().count << " loops) : naive = "
+              << naive_time.Summary().mean << ", tiled = " << tiled_time.Summary().mean << "\n";
+    naive_time.Print();
+    tiled_time.Print();
+
+    harness::RunInfo run;
+    run.kernel = "stencil";
+    run.variant = "VectorStencilTiled naive";
+    run.device = q.get_device().get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp32";
+    run.sizes = {{"n", N}, {"m", M}};
+    run.flops = 5.0 * (N-2) * (M-2);
+    // One read and one write sweep when the neighbour reads hit in cache
+    run.bytes = 2.0 * N * M * sizeof(float);
+    harness::WriteRecords(run, naive_time);
+
+    run.variant = "VectorStencilTiled";
+    run.sizes.push_back({"b", tile});
+    harness::WriteRecords(run, tiled_time);
+
+    free(D_a,q);
+    free(D_naive,q);
+    free(D_tiled,q);
+    return max_err < 1e-5 ? 0 : 1;
+}
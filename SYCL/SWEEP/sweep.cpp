@@ -0,0 +1,546 @@
+//==============================================================
+// In-process parameter sweep over the benchmark kernels.
+//
+// Runs every point of a grid (kernel x device x precision x memory model
+// x size) in one process.  Queues are created once per device and the
+// allocations are grown to the largest size seen and then reused, so a
+// scaling curve pays JIT and context creation once instead of once per
+// launch.  Every point is timed with the shared harness and written to
+// HARNESS_OUTPUT like the standalone drivers.
+//
+//   sweep [--kernels axpy,gemm,stencil,stream,matmul,mandelbrot]
+//         [--devices cpu,gpu] [--precisions fp32,fp64]
+//         [--memory usm_device,usm_shared,buffer]
+//         [--sizes 256,512,1024] [--repetitions 10]
+//
+// The size is the edge of a square problem: axpy and stream use n*n
+// elements, gemm and matmul n x n x n, stencil an n x n grid and
+// mandelbrot an n x n image.  Combinations a kernel does not implement
+// (e.g. mandelbrot in fp64) are skipped.
+// =============================================================
+
+#include <sycl/sycl.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef SWEEP_WITH_MKL
+#include "oneapi/mkl/blas.hpp"
+#endif
+#include "harness.hpp"
+#include "report.hpp"
+
+// The Mandelbrot kernel is used as is from the standalone driver.
+#include <CL/sycl.hpp>
+#include "../MANDELBROT/src/mandel.hpp"
+
+using namespace sycl;
+
+#define INDEX(N,i,j) ((i)*(N) + (j))
+
+namespace {
+
+struct Grid {
+    std::vector<std::string> kernels = {"axpy", "gemm", "stencil", "stream", "matmul", "mandelbrot"};
+    std::vector<std::string> devices = {"cpu"};
+    std::vector<std::string> precisions = {"fp32", "fp64"};
+    std::vector<std::string> memory = {"usm_device", "usm_shared", "buffer"};
+    std::vector<long long> sizes = {256, 512, 1024};
+    int repetitions = 10;
+};
+
+struct Point {
+    std::string kernel, device, precision, memory;
+    long long n;
+};
+
+std::vector<std::string> SplitList(const std::string &arg)
+{
+    std::vector<std::string> items;
+    std::stringstream in(arg);
+    std::string item;
+    while (std::getline(in, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    if (items.empty())
+        throw std::invalid_argument("empty list '" + arg + "'");
+    return items;
+}
+
+long long ParseCount(const std::string &arg, const char *what)
+{
+    char *end = nullptr;
+    long long value = std::strtoll(arg.c_str(), &end, 10);
+    if (arg.empty() || *end != '\0' || value < 1)
+        throw std::invalid_argument(std::string(what) + " must be a positive integer, got '" + arg + "'");
+    return value;
+}
+
+void CheckChoices(const std::vector<std::string> &items, const std::vector<std::string> &allowed, const char *what)
+{
+    for (const auto &item : items) {
+        bool found = false;
+        for (const auto &a : allowed)
+            found = found || item == a;
+        if (!found)
+            throw std::invalid_argument(std::string("unknown ") + what + " '" + item + "'");
+    }
+}
+
+Grid ParseGrid(int argc, char *argv[])
+{
+    Grid grid;
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (flag == "-h" || flag == "--help")
+            throw std::invalid_argument("help");
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + flag);
+        std::string value = argv[++i];
+
+        if (flag == "--kernels")
+            grid.kernels = SplitList(value);
+        else if (flag == "--devices")
+            grid.devices = SplitList(value);
+        else if (flag == "--precisions")
+            grid.precisions = SplitList(value);
+        else if (flag == "--memory")
+            grid.memory = SplitList(value);
+        else if (flag == "--sizes") {
+            grid.sizes.clear();
+            for (const auto &s : SplitList(value))
+                grid.sizes.push_back(ParseCount(s, "size"));
+        } else if (flag == "--repetitions")
+            grid.repetitions = (int)ParseCount(value, "repetitions");
+        else
+            throw std::invalid_argument("unknown option " + flag);
+    }
+
+    CheckChoices(grid.kernels, {"axpy", "gemm", "stencil", "stream", "matmul", "mandelbrot"}, "kernel");
+    CheckChoices(grid.devices, {"cpu", "gpu", "default"}, "device");
+    CheckChoices(grid.precisions, {"fp32", "fp64"}, "precision");
+    CheckChoices(grid.memory, {"usm_device", "usm_shared", "buffer"}, "memory model");
+    return grid;
+}
+
+void Usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [--kernels k1,k2,..] [--devices cpu,gpu,default]\n"
+              << "       [--precisions fp32,fp64] [--memory usm_device,usm_shared,buffer]\n"
+              << "       [--sizes n1,n2,..] [--repetitions r]\n"
+              << "kernels: axpy gemm stencil stream matmul mandelbrot\n";
+}
+
+// Grow-only allocations for one device.  Each slot keeps the largest
+// allocation requested so far; smaller grid points use its prefix.
+class Workspace {
+public:
+    explicit Workspace(const queue &q) : q_(q) {}
+    Workspace(const Workspace &) = delete;
+    Workspace &operator=(const Workspace &) = delete;
+
+    ~Workspace()
+    {
+        for (auto &slot : usm_)
+            free(slot.second.ptr, q_);
+    }
+
+    queue &Queue() { return q_; }
+
+    template <class T>
+    T *Usm(const std::string &slot, usm::alloc kind, size_t count)
+    {
+        Allocation &a = usm_[Key<T>(slot) + (kind == usm::alloc::device ? ":device" : ":shared")];
+        if (a.bytes < count * sizeof(T)) {
+            if (a.ptr != nullptr)
+                free(a.ptr, q_);
+            a.bytes = count * sizeof(T);
+            a.ptr = sycl::malloc(a.bytes, q_, kind);
+            if (a.ptr == nullptr) {
+                a.bytes = 0;
+                throw std::runtime_error("cannot allocate " + std::to_string(count * sizeof(T)) + " bytes of USM");
+            }
+        }
+        return static_cast<T*>(a.ptr);
+    }
+
+    template <class T>
+    buffer<T, 1> &Buffer(const std::string &slot, size_t count)
+    {
+        Holder &h = buffers_[Key<T>(slot)];
+        if (h.count < count) {
+            h.buf = std::make_shared<buffer<T, 1>>(range<1>(count));
+            h.count = count;
+        }
+        return *std::static_pointer_cast<buffer<T, 1>>(h.buf);
+    }
+
+private:
+    struct Allocation {
+        void *ptr = nullptr;
+        size_t bytes = 0;
+    };
+    struct Holder {
+        std::shared_ptr<void> buf;
+        size_t count = 0;
+    };
+
+    template <class T>
+    static std::string Key(const std::string &slot) { return slot + (sizeof(T) == 4 ? ":fp32" : ":fp64"); }
+
+    queue q_;
+    std::map<std::string, Allocation> usm_;
+    std::map<std::string, Holder> buffers_;
+};
+
+// Per-point work and its operation counts.  Allocation and initialisation
+// happen untimed when the case is made; `run` is the timed region and
+// blocks until the device is done.
+struct Case {
+    bool supported = true;
+    double flops = 0.0;
+    double bytes = 0.0;
+    std::function<void()> run;
+};
+
+template <class T>
+void Fill(Workspace &ws, T *ptr, size_t count, T value)
+{
+    ws.Queue().fill(ptr, value, count).wait();
+}
+
+template <class T>
+void Fill(Workspace &ws, buffer<T, 1> &buf, size_t count, T value)
+{
+    ws.Queue().submit([&](handler &h) {
+        accessor a(buf, h, write_only, no_init);
+        h.parallel_for(range<1>(count), [=](id<1> i) { a[i] = value; });
+    }).wait();
+}
+
+#ifdef SWEEP_WITH_MKL
+template <class T>
+Case Axpy(Workspace &ws, const Point &p)
+{
+    Case c;
+    const size_t count = p.n * p.n;
+    const T alpha = 1.5;
+    c.flops = 2.0 * count;
+    c.bytes = 3.0 * count * sizeof(T);
+
+    if (p.memory == "buffer") {
+        buffer<T, 1> &x = ws.Buffer<T>("x", count);
+        buffer<T, 1> &y = ws.Buffer<T>("y", count);
+        Fill(ws, x, count, T(10));
+        Fill(ws, y, count, T(20));
+        c.run = [&ws, &x, &y, count, alpha] {
+            oneapi::mkl::blas::axpy(ws.Queue(), count, alpha, x, 1, y, 1);
+            ws.Queue().wait();
+        };
+    } else {
+        usm::alloc kind = p.memory == "usm_device" ? usm::alloc::device : usm::alloc::shared;
+        T *x = ws.Usm<T>("x", kind, count);
+        T *y = ws.Usm<T>("y", kind, count);
+        Fill(ws, x, count, T(10));
+        Fill(ws, y, count, T(20));
+        c.run = [&ws, x, y, count, alpha] {
+            oneapi::mkl::blas::axpy(ws.Queue(), count, alpha, x, 1, y, 1).wait();
+        };
+    }
+    return c;
+}
+
+template <class T>
+Case Gemm(Workspace &ws, const Point &p)
+{
+    Case c;
+    const int64_t n = p.n;
+    const size_t count = n * n;
+    const auto nontrans = oneapi::mkl::transpose::nontrans;
+    c.flops = 2.0 * n * n * n;
+    // A and B read, C read and written
+    c.bytes = 4.0 * count * sizeof(T);
+
+    if (p.memory == "buffer") {
+        buffer<T, 1> &a = ws.Buffer<T>("a", count);
+        buffer<T, 1> &b = ws.Buffer<T>("b", count);
+        buffer<T, 1> &cm = ws.Buffer<T>("c", count);
+        Fill(ws, a, count, T(10));
+        Fill(ws, b, count, T(20));
+        Fill(ws, cm, count, T(0));
+        c.run = [&ws, &a, &b, &cm, n, nontrans] {
+            oneapi::mkl::blas::gemm(ws.Queue(), nontrans, nontrans, n, n, n, T(1), a, n, b, n, T(0), cm, n);
+            ws.Queue().wait();
+        };
+    } else {
+        usm::alloc kind = p.memory == "usm_device" ? usm::alloc::device : usm::alloc::shared;
+        T *a = ws.Usm<T>("a", kind, count);
+        T *b = ws.Usm<T>("b", kind, count);
+        T *cm = ws.Usm<T>("c", kind, count);
+        Fill(ws, a, count, T(10));
+        Fill(ws, b, count, T(20));
+        Fill(ws, cm, count, T(0));
+        c.run = [&ws, a, b, cm, n, nontrans] {
+            oneapi::mkl::blas::gemm(ws.Queue(), nontrans, nontrans, n, n, n, T(1), a, n, b, n, T(0), cm, n).wait();
+        };
+    }
+    return c;
+}
+#endif
+
+// 5pt stencil followed by the copy-back pass, as in STENCIL/VectorStencilB.
+template <class T>
+Case Stencil(Workspace &ws, const Point &p)
+{
+    Case c;
+    const int N = p.n;
+    if (N < 3) {   // no interior points to update
+        c.supported = false;
+        return c;
+    }
+    const size_t count = (size_t)N * N;
+    c.flops = 5.0 * (N-2) * (N-2);
+    c.bytes = 4.0 * count * sizeof(T);
+
+    if (p.memory == "buffer") {
+        buffer<T, 1> &a = ws.Buffer<T>("a", count);
+        buffer<T, 1> &s = ws.Buffer<T>("b", count);
+        Fill(ws, a, count, T(1));
+        c.run = [&ws, &a, &s, N] {
+            queue &q = ws.Queue();
+            q.submit([&](handler &h) {
+                accessor Mat_A(a, h, read_only);
+                accessor Mat_Stencil(s, h, write_only);
+                h.parallel_for(range<2>(N-2,N-2), [=](id<2> index){
+                    int row = index[0] + 1;
+                    int col = index[1] + 1;
+                    Mat_Stencil[INDEX((N-2),(row-1),(col-1))] = (4*Mat_A[INDEX(N,row,col)] - Mat_A[INDEX(N,(row-1),col)] - Mat_A[INDEX(N,(row+1),col)] - Mat_A[INDEX(N,row,(col-1))] - Mat_A[INDEX(N,row,(col+1))]);
+                });
+            });
+            q.submit([&](handler &h) {
+                accessor Mat_A(a, h, write_only);
+                accessor Mat_Stencil(s, h, read_only);
+                h.parallel_for(range<2>(N-2,N-2), [=](id<2> index){
+                    int row = index[0] + 1;
+                    int col = index[1] + 1;
+                    Mat_A[INDEX(N,row,col)] = Mat_Stencil[INDEX((N-2),(row-1),(col-1))];
+                });
+            });
+            q.wait();
+        };
+    } else {
+        usm::alloc kind = p.memory == "usm_device" ? usm::alloc::device : usm::alloc::shared;
+        T *Mat_A = ws.Usm<T>("a", kind, count);
+        T *Mat_Stencil = ws.Usm<T>("b", kind, count);
+        Fill(ws, Mat_A, count, T(1));
+        c.run = [&ws, Mat_A, Mat_Stencil, N] {
+            queue &q = ws.Queue();
+            q.parallel_for(range<2>(N-2,N-2), [=](id<2> index){
+                int row = index[0] + 1;
+                int col = index[1] + 1;
+                Mat_Stencil[INDEX((N-2),(row-1),(col-1))] = (4*Mat_A[INDEX(N,row,col)] - Mat_A[INDEX(N,(row-1),col)] - Mat_A[INDEX(N,(row+1),col)] - Mat_A[INDEX(N,row,(col-1))] - Mat_A[INDEX(N,row,(col+1))]);
+            }).wait();
+            q.parallel_for(range<2>(N-2,N-2), [=](id<2> index){
+                int row = index[0] + 1;
+                int col = index[1] + 1;
+                Mat_A[INDEX(N,row,col)] = Mat_Stencil[INDEX((N-2),(row-1),(col-1))];
+            }).wait();
+        };
+    }
+    return c;
+}
+
+// Device-side copy, as the "device copy" series of Stream/bandwidth.
+template <class T>
+Case Stream(Workspace &ws, const Point &p)
+{
+    Case c;
+    const size_t count = p.n * p.n;
+    c.bytes = 2.0 * count * sizeof(T);
+
+    if (p.memory == "buffer") {
+        buffer<T, 1> &src = ws.Buffer<T>("a", count);
+        buffer<T, 1> &dst = ws.Buffer<T>("b", count);
+        Fill(ws, src, count, T(10));
+        c.run = [&ws, &src, &dst, count] {
+            ws.Queue().submit([&](handler &h) {
+                accessor source(src, h, read_only);
+                accessor destination(dst, h, write_only, no_init);
+                h.parallel_for(range<1>(count), [=](id<1> i) { destination[i] = source[i]; });
+            }).wait();
+        };
+    } else {
+        usm::alloc kind = p.memory == "usm_device" ? usm::alloc::device : usm::alloc::shared;
+        T *source = ws.Usm<T>("a", kind, count);
+        T *destination = ws.Usm<T>("b", kind, count);
+        Fill(ws, source, count, T(10));
+        c.run = [&ws, source, destination, count] {
+            ws.Queue().parallel_for(range<1>(count), [=](id<1> i) { destination[i] = source[i]; }).wait();
+        };
+    }
+    return c;
+}
+
+// Naive matrix product of VectorMultA without the transfers.
+template <class T>
+Case Matmul(Workspace &ws, const Point &p)
+{
+    Case c;
+    const int N = p.n;
+    const size_t count = (size_t)N * N;
+    c.flops = 2.0 * N * N * N;
+    c.bytes = 3.0 * count * sizeof(T);
+
+    if (p.memory == "buffer") {
+        c.supported = false;
+        return c;
+    }
+    usm::alloc kind = p.memory == "usm_device" ? usm::alloc::device : usm::alloc::shared;
+    T *a = ws.Usm<T>("a", kind, count);
+    T *b = ws.Usm<T>("b", kind, count);
+    T *cm = ws.Usm<T>("c", kind, count);
+    Fill(ws, a, count, T(10));
+    Fill(ws, b, count, T(20));
+    c.run = [&ws, a, b, cm, N] {
+        ws.Queue().parallel_for(range<2>(N,N), [=](id<2> index){
+            int row = index[0];
+            int col = index[1];
+            T sum = 0;
+            for(int k=0;k<N;k++)
+                sum += a[row*N + k] * b[k*N + col];
+            cm[row*N + col] = sum;
+        }).wait();
+    };
+    return c;
+}
+
+Case Mandelbrot(Workspace &ws, const Point &p, std::unique_ptr<MandelParallel> &image)
+{
+    Case c;
+    if (p.precision != "fp32" || (p.memory != "buffer" && p.memory != "usm_device")) {
+        c.supported = false;
+        return c;
+    }
+    image = std::make_unique<MandelParallel>(p.n, p.n, max_iterations);
+    c.bytes = (double)p.n * p.n * sizeof(int);
+    MandelParallel *m = image.get();
+    if (p.memory == "usm_device")
+        c.run = [&ws, m] { m->EvaluateUsm(ws.Queue()); };   // image stays on the device
+    else
+        c.run = [&ws, m] { m->Evaluate(ws.Queue()); };
+    return c;
+}
+
+Case MakeCase(Workspace &ws, const Point &p, std::unique_ptr<MandelParallel> &image)
+{
+    bool fp32 = p.precision == "fp32";
+#ifdef SWEEP_WITH_MKL
+    if (p.kernel == "axpy")
+        return fp32 ? Axpy<float>(ws, p) : Axpy<double>(ws, p);
+    if (p.kernel == "gemm")
+        return fp32 ? Gemm<float>(ws, p) : Gemm<double>(ws, p);
+#endif
+    if (p.kernel == "stencil")
+        return fp32 ? Stencil<float>(ws, p) : Stencil<double>(ws, p);
+    if (p.kernel == "stream")
+        return fp32 ? Stream<float>(ws, p) : Stream<double>(ws, p);
+    if (p.kernel == "matmul")
+        return fp32 ? Matmul<float>(ws, p) : Matmul<double>(ws, p);
+    if (p.kernel == "mandelbrot")
+        return Mandelbrot(ws, p, image);
+
+    // axpy and gemm without oneMKL
+    Case c;
+    c.supported = false;
+    return c;
+}
+
+queue MakeQueue(const std::string &device)
+{
+    if (device == "cpu")
+        return queue(cpu_selector_v);
+    if (device == "gpu")
+        return queue(gpu_selector_v);
+    return queue(default_selector_v);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    Grid grid;
+    try {
+        grid = ParseGrid(argc, argv);
+    } catch (const std::invalid_argument &e) {
+        bool help = std::strcmp(e.what(), "help") == 0;
+        if (!help)
+            std::cerr << "sweep: " << e.what() << "\n";
+        Usage(argv[0]);
+        return help ? 0 : 1;
+    }
+
+    harness::Options opts = harness::Options::FromEnv(grid.repetitions);
+
+    std::printf("%-10s %-6s %-5s %-10s %8s %14s %10s %10s\n",
+                "kernel", "device", "prec", "memory", "n", "median (s)", "GFLOP/s", "GB/s");
+
+    for (const auto &device : grid.devices) {
+        std::unique_ptr<Workspace> ws;
+        try {
+            ws = std::make_unique<Workspace>(MakeQueue(device));
+        } catch (const sycl::exception &e) {
+            std::cerr << "sweep: skipping device " << device << ": " << e.what() << "\n";
+            continue;
+        }
+        std::string device_name = ws->Queue().get_device().get_info<info::device::name>();
+        bool has_fp64 = ws->Queue().get_device().has(aspect::fp64);
+
+        for (const auto &kernel : grid.kernels)
+        for (const auto &precision : grid.precisions)
+        for (const auto &memory : grid.memory)
+        for (long long n : grid.sizes) {
+            Point p{kernel, device, precision, memory, n};
+            if (precision == "fp64" && !has_fp64)
+                continue;
+
+            std::ostringstream name;
+            name << kernel << " " << device << " " << precision << " " << memory << " n=" << n;
+            harness::Series series(name.str(), opts);
+            harness::Stats stats;
+            Case c;
+            // A point that fails to allocate or run is reported and skipped; the sweep goes on
+            try {
+                std::unique_ptr<MandelParallel> image;
+                c = MakeCase(*ws, p, image);
+                if (!c.supported)
+                    continue;
+                stats = harness::Run(series, c.run);
+            } catch (const std::exception &e) {   // sycl::exception or a failed allocation
+                std::cerr << "sweep: skipping " << name.str() << ": " << e.what() << "\n";
+                continue;
+            }
+
+            std::printf("%-10s %-6s %-5s %-10s %8lld %14.9f %10.3f %10.3f\n",
+                        kernel.c_str(), device.c_str(), precision.c_str(), memory.c_str(), n,
+                        stats.median, c.flops / stats.median * 1e-9, c.bytes / stats.median * 1e-9);
+
+            harness::RunInfo run;
+            run.kernel = kernel;
+            run.variant = "sweep";
+            run.device = device_name;
+            run.memory = memory;
+            run.precision = precision;
+            run.sizes = {{"n", n}};
+            run.flops = c.flops;
+            run.bytes = c.bytes;
+            harness::WriteRecords(run, series);
+        }
+    }
+    return 0;
+}
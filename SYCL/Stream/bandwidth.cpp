@@ -1,54 +1,17 @@
 #include <sycl/sycl.hpp>
 #include<sys/sysinfo.h>
-#include<sys/time.h>
+#include "harness.hpp"
+#include "report.hpp"
 
 //using namespace hipsycl::sycl;
 using namespace sycl;
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main()
 {
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int host_start,host_end,dev_start,dev_end;
-    double elapsed_host1[10],elapsed_dev[10],elapsed_host2[10],HAverage1 = 0.0, HAverage2 = 0.0, DAverage = 0.0;
+    harness::Options opts = harness::Options::FromEnv(10);
+    harness::Series host_to_device("host to device", opts);
+    harness::Series device_copy("device copy", opts);
+    harness::Series device_to_host("device to host", opts);
     queue q(default_selector_v);
 
     double *source         = static_cast<double*>(malloc(4*1024*1024*sizeof(double)));
@@ -60,43 +23,51 @@ int main()
 
     std::cout << "Device : " << q.get_device().get_info<info::device::name>() << "\n";
 
-    Calibrate(&ClkPerSec,NSecClk);
-
-    for(int count=0;count<10;count++)
+    for(int count=0;count<device_copy.iterations();count++)
     {
-        host_start = rdtsc();
+        harness::Timer timer(opts.clock);
         auto hostcopy = q.memcpy(destination,source,(sizeof(double)*4*1024*1024));
 	hostcopy.wait();
-        host_end = rdtsc();
-        elapsed_host1[count] = (double)(host_end - host_start)/ClkPerSec;
+        host_to_device.Record(timer.Elapsed());
 
-        dev_start = rdtsc();
+        timer.Start();
         q.parallel_for(range<1>(4*1024*1024), [=](auto index){
             copy_destination[index] = destination[index];
         }).wait();
-        dev_end = rdtsc();
-        elapsed_dev[count] = (double)(dev_end - dev_start)/ClkPerSec;
+        device_copy.Record(timer.Elapsed());
 
-        host_start = rdtsc();
+        timer.Start();
         auto host2copy = q.memcpy(source,copy_destination,(sizeof(double)*4*1024*1024));
         host2copy.wait();
-        host_end = rdtsc();
-        elapsed_host2[count] = (double)(host_end - host_start)/ClkPerSec;
+        device_to_host.Record(timer.Elapsed());
     }
 
-    for(int i = 0;i<10;i++)
-    {
-        HAverage1 += elapsed_host1[i];
-        HAverage2 += elapsed_host2[i];
-        DAverage  += elapsed_dev[i];
-    }
-    HAverage1 = HAverage1/10;
-    HAverage2 = HAverage2/10;
-    DAverage  = DAverage/10;
-    
-    std::cout << "Host Transfer Bandwidth   : " << (4)/(HAverage1*1024) << " GB/s\n"
-              << "Device Bandwidth          : " << (4)/(DAverage*1024) << " GB/s\n"
-              << "Device Transfer Bandwidth : " << (4)/(HAverage2*1024)  << " GB/s" << std::endl;
+    double HAverage1 = host_to_device.Summary().mean;
+    double HAverage2 = device_to_host.Summary().mean;
+    double DAverage  = device_copy.Summary().mean;
+
+    // The device copy reads and writes the array, the transfers move it once.
+    const double bytes = sizeof(double)*4*1024*1024;
+
+    std::cout << "Host Transfer Bandwidth   : " << bytes/(HAverage1*1e9) << " GB/s\n"
+              << "Device Bandwidth          : " << 2*bytes/(DAverage*1e9) << " GB/s\n"
+              << "Device Transfer Bandwidth : " << bytes/(HAverage2*1e9)  << " GB/s" << std::endl;
+    host_to_device.Print();
+    device_copy.Print();
+    device_to_host.Print();
+
+    harness::RunInfo run;
+    run.kernel = "stream";
+    run.variant = "bandwidth";
+    run.device = q.get_device().get_info<info::device::name>();
+    run.memory = "usm_device";
+    run.precision = "fp64";
+    run.sizes = {{"n", 4*1024*1024}};
+    run.bytes = bytes;
+    harness::WriteRecords(run, host_to_device);
+    harness::WriteRecords(run, device_to_host);
+    run.bytes = 2*bytes;
+    harness::WriteRecords(run, device_copy);
  
     return 0;
 }
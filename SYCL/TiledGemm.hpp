@@ -0,0 +1,223 @@
+//==============================================================
+// Tiled local-memory GEMM engine for the VectorMult drivers.
+//
+// C (N x M) = A (N x K) * B (K x M), all row-major and contiguous.
+//
+// Each work-group computes a BM x BN block of C.  The K dimension is
+// walked in BK-deep slices: the work-group stages the BM x BK slice of A
+// and the BK x BN slice of B in local memory, then every work-item
+// accumulates an RM x RN register block from the staged tiles.  Edges
+// that do not divide the tile sizes are zero-padded, so any N, M, K work.
+//
+// The same kernel body serves the three memory models of VectorMultA/B/C:
+// Gemm(q, A, B, C, ...) takes USM pointers (device or shared), and
+// Gemm(q, bufA, bufB, bufC, ...) takes 2D buffers.
+//
+// GemmNorm() additionally reduces the squared Frobenius norm of C in the
+// epilogue, while the block is still in registers: a sub-group reduce,
+// then the sub-group sums are combined in local memory and one partial
+// per work-group is written to Partials[group].  Normalize() then sums
+// the partials in a fixed order and scales C on the device, so the norm
+// is deterministic and never round-trips through the host.
+// =============================================================
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <vector>
+
+namespace tiled_gemm {
+
+// Default tiling: 64x64 block of C per 16x16 work-group, 4x4 per work-item.
+template <class T, int BM = 64, int BN = 64, int BK = 16, int RM = 4, int RN = 4>
+struct Config {
+    using value_type = T;
+    static constexpr int bm = BM, bn = BN, bk = BK, rm = RM, rn = RN;
+    static constexpr int local_rows = BM / RM;   // work-group shape
+    static constexpr int local_cols = BN / RN;
+    static constexpr int threads = local_rows * local_cols;
+
+    static_assert(BM % RM == 0 && BN % RN == 0, "register block must divide the tile");
+    // The epilogue reuses the A staging tile for one sum per sub-group
+    static_assert(BM * BK >= threads, "A tile too small for the norm epilogue");
+
+    static size_t Groups(int N, int M) { return (size_t)((N + BM - 1) / BM) * ((M + BN - 1) / BN); }
+
+    static sycl::nd_range<2> Range(int N, int M)
+    {
+        const size_t groups_n = (N + BM - 1) / BM, groups_m = (M + BN - 1) / BN;
+        return sycl::nd_range<2>(sycl::range<2>(groups_n * local_rows, groups_m * local_cols),
+                                 sycl::range<2>(local_rows, local_cols));
+    }
+};
+
+// One work-item's share of the block product.  As/Bs point to BM*BK and
+// BK*BN elements of local memory.  Rows and columns of the register block
+// are strided by the work-group shape so neighbouring work-items read
+// neighbouring local-memory words.  With Partials != nullptr the
+// work-group's sum of squares of its block is stored in
+// Partials[group linear id].
+template <class Cfg, class T = typename Cfg::value_type>
+inline void Block(sycl::nd_item<2> it, const T *A, const T *B, T *C, int N, int M, int K, T *As, T *Bs,
+                  T *Partials = nullptr)
+{
+    constexpr int BM = Cfg::bm, BN = Cfg::bn, BK = Cfg::bk, RM = Cfg::rm, RN = Cfg::rn;
+    constexpr int LR = Cfg::local_rows, LC = Cfg::local_cols, NT = Cfg::threads;
+
+    const int ty = it.get_local_id(0), tx = it.get_local_id(1);
+    const int lid = ty * LC + tx;
+    const int row0 = it.get_group(0) * BM, col0 = it.get_group(1) * BN;
+
+    T acc[RM][RN];
+    for (int i = 0; i < RM; i++)
+        for (int j = 0; j < RN; j++)
+            acc[i][j] = T(0);
+
+    for (int k0 = 0; k0 < K; k0 += BK) {
+        // Cooperative, zero-padded loads of the A and B slices
+        for (int i = lid; i < BM * BK; i += NT) {
+            int r = row0 + i / BK, k = k0 + i % BK;
+            As[i] = (r < N && k < K) ? A[(size_t)r * K + k] : T(0);
+        }
+        for (int i = lid; i < BK * BN; i += NT) {
+            int k = k0 + i / BN, c = col0 + i % BN;
+            Bs[i] = (k < K && c < M) ? B[(size_t)k * M + c] : T(0);
+        }
+        sycl::group_barrier(it.get_group());
+
+        for (int kk = 0; kk < BK; kk++) {
+            T a[RM], b[RN];
+            for (int i = 0; i < RM; i++)
+                a[i] = As[(ty + i * LR) * BK + kk];
+            for (int j = 0; j < RN; j++)
+                b[j] = Bs[kk * BN + tx + j * LC];
+            for (int i = 0; i < RM; i++)
+                for (int j = 0; j < RN; j++)
+                    acc[i][j] += a[i] * b[j];
+        }
+        sycl::group_barrier(it.get_group());
+    }
+
+    T sq = T(0);
+    for (int i = 0; i < RM; i++)
+        for (int j = 0; j < RN; j++) {
+            int r = row0 + ty + i * LR, c = col0 + tx + j * LC;
+            if (r < N && c < M) {
+                C[(size_t)r * M + c] = acc[i][j];
+                sq += acc[i][j] * acc[i][j];
+            }
+        }
+
+    if (Partials == nullptr)
+        return;
+
+    // Sub-group reduce, then the sub-group sums are added in order by one work-item
+    sycl::sub_group sg = it.get_sub_group();
+    T sg_sum = sycl::reduce_over_group(sg, sq, sycl::plus<T>());
+    if (sg.get_local_linear_id() == 0)
+        As[sg.get_group_linear_id()] = sg_sum;
+    sycl::group_barrier(it.get_group());
+
+    if (lid == 0) {
+        T group_sum = T(0);
+        for (size_t s = 0; s < sg.get_group_linear_range(); s++)
+            group_sum += As[s];
+        Partials[it.get_group_linear_id()] = group_sum;
+    }
+}
+
+// USM pointers (device or shared allocations).
+template <class T, class Cfg = Config<T>>
+sycl::event GemmNorm(sycl::queue &q, const T *A, const T *B, T *C, int N, int M, int K, T *Partials,
+                     const std::vector<sycl::event> &deps = {})
+{
+    return q.submit([&](sycl::handler &h) {
+        h.depends_on(deps);
+        sycl::local_accessor<T, 1> As(sycl::range<1>(Cfg::bm * Cfg::bk), h);
+        sycl::local_accessor<T, 1> Bs(sycl::range<1>(Cfg::bk * Cfg::bn), h);
+        h.parallel_for(Cfg::Range(N, M), [=](sycl::nd_item<2> it) {
+            Block<Cfg>(it, A, B, C, N, M, K,
+                       As.template get_multi_ptr<sycl::access::decorated::no>().get(),
+                       Bs.template get_multi_ptr<sycl::access::decorated::no>().get(), Partials);
+        });
+    });
+}
+
+template <class T, class Cfg = Config<T>>
+sycl::event Gemm(sycl::queue &q, const T *A, const T *B, T *C, int N, int M, int K,
+                 const std::vector<sycl::event> &deps = {})
+{
+    return GemmNorm<T, Cfg>(q, A, B, C, N, M, K, nullptr, deps);
+}
+
+// 2D buffers of shape (N,K), (K,M) and (N,M); Partials is a USM allocation.
+template <class T, class Cfg = Config<T>>
+sycl::event GemmNorm(sycl::queue &q, sycl::buffer<T, 2> &bufA, sycl::buffer<T, 2> &bufB, sycl::buffer<T, 2> &bufC,
+                     int N, int M, int K, T *Partials)
+{
+    return q.submit([&](sycl::handler &h) {
+        sycl::accessor A(bufA, h, sycl::read_only);
+        sycl::accessor B(bufB, h, sycl::read_only);
+        sycl::accessor C(bufC, h, sycl::write_only, sycl::no_init);
+        sycl::local_accessor<T, 1> As(sycl::range<1>(Cfg::bm * Cfg::bk), h);
+        sycl::local_accessor<T, 1> Bs(sycl::range<1>(Cfg::bk * Cfg::bn), h);
+        h.parallel_for(Cfg::Range(N, M), [=](sycl::nd_item<2> it) {
+            Block<Cfg>(it,
+                       A.template get_multi_ptr<sycl::access::decorated::no>().get(),
+                       B.template get_multi_ptr<sycl::access::decorated::no>().get(),
+                       C.template get_multi_ptr<sycl::access::decorated::no>().get(), N, M, K,
+                       As.template get_multi_ptr<sycl::access::decorated::no>().get(),
+                       Bs.template get_multi_ptr<sycl::access::decorated::no>().get(), Partials);
+        });
+    });
+}
+
+template <class T, class Cfg = Config<T>>
+sycl::event Gemm(sycl::queue &q, sycl::buffer<T, 2> &bufA, sycl::buffer<T, 2> &bufB, sycl::buffer<T, 2> &bufC,
+                 int N, int M, int K)
+{
+    return GemmNorm<T, Cfg>(q, bufA, bufB, bufC, N, M, K, nullptr);
+}
+
+// Sums Partials[0..groups) in order into the Frobenius norm, stored in
+// Partials[groups].  Partials needs Cfg::Groups(N,M) + 1 elements.
+template <class T>
+sycl::event FinishNorm(sycl::queue &q, T *Partials, size_t groups, const std::vector<sycl::event> &deps = {})
+{
+    return q.submit([&](sycl::handler &h) {
+        h.depends_on(deps);
+        h.single_task([=]() {
+            T sum = T(0);
+            for (size_t g = 0; g < groups; g++)
+                sum += Partials[g];
+            Partials[groups] = sycl::sqrt(sum);
+        });
+    });
+}
+
+// Divides the count elements of C by the norm left by GemmNorm.
+template <class T>
+sycl::event Normalize(sycl::queue &q, T *C, size_t count, T *Partials, size_t groups,
+                      const std::vector<sycl::event> &deps = {})
+{
+    auto e = FinishNorm(q, Partials, groups, deps);
+    return q.submit([&](sycl::handler &h) {
+        h.depends_on(e);
+        h.parallel_for(sycl::range<1>(count), [=](sycl::id<1> i) { C[i] = C[i] / Partials[groups]; });
+    });
+}
+
+template <class T>
+sycl::event Normalize(sycl::queue &q, sycl::buffer<T, 2> &bufC, T *Partials, size_t groups,
+                      const std::vector<sycl::event> &deps = {})
+{
+    // Partials is USM, so the GemmNorm event must be passed in deps
+    auto e = FinishNorm(q, Partials, groups, deps);
+    return q.submit([&](sycl::handler &h) {
+        h.depends_on(e);
+        sycl::accessor C(bufC, h, sycl::read_write);
+        h.parallel_for(C.get_range(), [=](sycl::id<2> i) { C[i] = C[i] / Partials[groups]; });
+    });
+}
+
+}  // namespace tiled_gemm
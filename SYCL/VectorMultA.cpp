@@ -1,57 +1,18 @@
 //#include <SYCL/sycl.hpp>
 #include <sycl/sycl.hpp>
 #include<sys/sysinfo.h>
-#include<sys/time.h>
+#include "harness.hpp"
+#include "TiledGemm.hpp"
 
 //using namespace hipsycl::sycl;
 using namespace sycl;
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main()
 {
     const int N=8192,M=8192,K=4096;
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[10],Average = 0.0;
+    harness::Options opts = harness::Options::FromEnv(10);
+    harness::Series mult_time("VectorMultA", opts);
 
     queue q(default_selector_v);
 
@@ -61,7 +22,6 @@ int main()
     double *vector1 = static_cast<double*>(malloc(N*K*sizeof(double)));
     double *vector2 = static_cast<double*>(malloc(K*M*sizeof(double)));
     double *vector3 = static_cast<double*>(malloc(N*M*sizeof(double)));
-    double *FNorm = static_cast<double*>(malloc_shared(sizeof(double),q));
 
     for(int i=0;i<N*K;i++)
         vector1[i] = 10.0;
@@ -94,48 +54,28 @@ int main()
     auto *vector2_device = static_cast<double*>(malloc_device<double>(K*M,q));
     auto *vector3_device = static_cast<double*>(malloc_device<double>(N*M,q));
 
-    Calibrate(&ClkPerSec,NSecClk);
+    // One squared-norm partial per work-group of the GEMM, plus the final norm
+    const size_t groups = tiled_gemm::Config<double>::Groups(N,M);
+    auto *Partials = static_cast<double*>(malloc_device<double>(groups+1,q));
 
-    for(int count=0;count<10;count++)
+    for(int count=0;count<mult_time.iterations();count++)
     {
-        FNorm[0] = 0.0;
-
-        start = rdtsc();
+        harness::Timer timer(opts.clock);
 
         auto e1 = q.memcpy(vector1_device,vector1,(sizeof(double)*N*K));
         auto e2 = q.memcpy(vector2_device,vector2,(sizeof(double)*K*M));
 
-        // Kernel to multiply the two Two-Dim Vectors
-
-        q.parallel_for(range<2>(N,M), {e1,e2}, [=](auto index){
-
-            int row = index.get_id(0);
-            int col = index.get_id(1);
-
-            double sum = 0.0;
-            for(int k=0;k<K;k++)
-                sum += vector1_device[row*K + k] * vector2_device[k*M + col];
+        // Multiply the two Two-Dim Vectors, reducing the Frobenius norm in the epilogue
+        auto e3 = tiled_gemm::GemmNorm(q, vector1_device, vector2_device, vector3_device, N, M, K, Partials, {e1,e2});
 
-            vector3_device[row*N + col] = sum;
-            FNorm[0] += (sum*sum);
-        }).wait();
-
-        FNorm[0] = std::sqrt(FNorm[0]);
-
-        auto e4 = q.parallel_for(range<2>(N,M), [=](auto index){
-
-            int row = index.get_id(0);
-            int col = index.get_id(1);
-
-            vector3_device[row*N + col] = vector3_device[row*N + col]/FNorm[0];
-        });
+        // Normalize on the device, the norm never leaves it
+        auto e4 = tiled_gemm::Normalize(q, vector3_device, (size_t)N*M, Partials, groups, {e3});
 
         q.memcpy(vector3,vector3_device,sizeof(double)*N*M,e4).wait();
 
-        end = rdtsc();
-
-        elapsed_count[count] = (double)(end - start)/ClkPerSec;
-        std::printf("TTC : %.12f\n",elapsed_count[count]);
+        double ttc = timer.Elapsed();
+        mult_time.Record(ttc);
+        std::printf("TTC : %.12f\n",ttc);
     }
 
     // Print updated Vector1 after Sum
@@ -149,15 +89,17 @@ int main()
         std::cout << "\n";
     }*/
 
-    for(int count=0;count<10;count++)
-        Average += elapsed_count[count];
+    double FNorm;
+    q.memcpy(&FNorm,Partials+groups,sizeof(double)).wait();
+    printf("\nFrobenius Norm of Product = %.6f\n",FNorm);
 
-    Average = Average/10.0;
-    printf("\nTime to compute Matrix Product (Copy + Computation + Copy) = %.12f\n",Average);
+    printf("\nTime to compute Matrix Product (Copy + Computation + Copy) = %.12f\n",mult_time.Summary().mean);
+    mult_time.Print();
 
     free(vector1_device,q);
     free(vector2_device,q);
     free(vector3_device,q);
+    free(Partials,q);
     free(vector1);
     free(vector2);
     free(vector3);
@@ -1,149 +1,101 @@
 //#include <SYCL/sycl.hpp>
 #include <sycl/sycl.hpp>
 #include<sys/sysinfo.h>
-#include<sys/time.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "harness.hpp"
+#include "TiledGemm.hpp"
 
 //using namespace hipsycl::sycl;
 using namespace sycl;
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
+// Exercise the tiled GEMM engine (TiledGemm.hpp) on sizes that do not
+// divide the tiles, for two tile configurations, and check the product
+// and the fused Frobenius norm against a host triple loop.  Returns the
+// larger of the max abs error of C and the relative error of the norm.
 
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
+template <class Cfg>
+static double Check(queue &q, harness::Series &series, const double *vector1, const double *vector2,
+                    const double *reference, double reference_norm, int N, int M, int K)
 {
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
+    auto *vector1_device = static_cast<double*>(malloc_device<double>(N*K,q));
+    auto *vector2_device = static_cast<double*>(malloc_device<double>(K*M,q));
+    auto *vector3_device = static_cast<double*>(malloc_device<double>(N*M,q));
+    const size_t groups = Cfg::Groups(N,M);
+    auto *Partials = static_cast<double*>(malloc_device<double>(groups+1,q));
+    std::vector<double> vector3(N*M);
+    double norm = 0.0;
+
+    for(int count=0;count<series.iterations();count++)
+    {
+        harness::Timer timer(series.options().clock);
 
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
+        auto e1 = q.memcpy(vector1_device,vector1,(sizeof(double)*N*K));
+        auto e2 = q.memcpy(vector2_device,vector2,(sizeof(double)*K*M));
+        auto e3 = tiled_gemm::GemmNorm<double,Cfg>(q, vector1_device, vector2_device, vector3_device, N, M, K, Partials, {e1,e2});
+        auto e4 = tiled_gemm::FinishNorm(q, Partials, groups, {e3});
+        q.memcpy(vector3.data(),vector3_device,sizeof(double)*N*M,e3);
+        q.memcpy(&norm,Partials+groups,sizeof(double),e4).wait();
 
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
+        series.Record(timer.Elapsed());
+    }
 
-    diff = stop-start;
-    difftick = stoptick-starttick;
+    double max_err = 0.0;
+    for(int i=0;i<N*M;i++)
+        max_err = std::max(max_err,std::fabs(vector3[i]-reference[i]));
+    max_err = std::max(max_err,std::fabs(norm-reference_norm)/reference_norm);
 
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
+    free(vector1_device,q);
+    free(vector2_device,q);
+    free(vector3_device,q);
+    free(Partials,q);
+    return max_err;
 }
 
 int main()
 {
-    const int N=8,M=8,K=2;
+    const int N=300,M=200,K=77;
 
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[10],Average = 0.0;
-    int TileN = N/4, TileM = M/4, TileK = K/1;
+    harness::Options opts = harness::Options::FromEnv(1);
+    harness::Series default_time("VectorMultATile 64x64x16/4x4", opts);
+    harness::Series small_time("VectorMultATile 32x32x8/2x2", opts);
 
     queue q(default_selector_v);
 
     std::cout << "Device : " << q.get_device().get_info<info::device::name>() << "\n";
     auto sg_size = q.get_device().get_info<info::device::sub_group_sizes>();
     std::cout << "Supported Sub-Group Sizes : ";
-    for (int i=0; i<sg_size.size(); i++) std::cout << sg_size[i] << " "; std::cout << "\n"; 
-
-    // Initialize Vectors and Print Values
-    int *vector1 = static_cast<int*>(malloc(N*K*sizeof(int)));
-    int *vector2 = static_cast<int*>(malloc(K*M*sizeof(int)));
-    int *vector3 = static_cast<int*>(malloc(N*M*sizeof(int)));
+    for (int i=0; i<sg_size.size(); i++) std::cout << sg_size[i] << " "; std::cout << "\n";
 
+    // Initialize Vectors
+    std::vector<double> vector1(N*K), vector2(K*M), reference(N*M);
     for(int i=0;i<N*K;i++)
-        vector1[i] = 10;
+        vector1[i] = (i%13) - 6.0;
 
     for(int i=0;i<K*M;i++)
-        vector2[i] = 20;
-
-    /*std::cout << "\nInput Vector1: \n";
-    for(int i=0;i<(N*K);i+=K)
-    {
-        for(int j=i;j<(i+K);j++)
-            std::cout << vector1[j] << " ";
-        std::cout << "\n";
-    }
-    std::cout << "\nInput Vector2: \n";
-    for(int i=0;i<(K*M);i+=M)
-    {
-        for(int j=i;j<(i+M);j++)
-            std::cout << vector2[j] << " ";
-        std::cout << "\n";
-    }
-    std::cout << "\n";
-    */
-
-    // Initialize Device USM and copy host data over to device for processing
-
-    auto *vector1_device = static_cast<int*>(malloc_device<int>(N*K,q));
-    auto *vector2_device = static_cast<int*>(malloc_device<int>(K*M,q));
-    auto *vector3_device = static_cast<int*>(malloc_device<int>(N*M,q));
-
-    Calibrate(&ClkPerSec,NSecClk);
-
-    for(int count=0;count<1;count++)
-    {
-        start = rdtsc();
-
-        auto e1 = q.memcpy(vector1_device,vector1,(sizeof(int)*N*K));
-        auto e2 = q.memcpy(vector2_device,vector2,(sizeof(int)*K*M));
-
-        // Kernel to multiply the two Two-Dim Vectors
-
-        auto e3 = q.parallel_for(range<2>(N,M), id<2>(1,2), {e1,e2}, [=](item<2> index){
-
-            int row = index[0];
-            int col = index[1];
-
-            printf("Row = %d, Col = %d\n",row,col);
-        });
-
-
-        q.memcpy(vector3,vector3_device,sizeof(int)*N*M,e3).wait();
-
-        end = rdtsc();
-
-        elapsed_count[count] = (double)(end - start)/ClkPerSec;
-    }
-
-    // Print updated Vector1 after Sum
-
-    /*std::cout << "\nOutput Vector3: \n";
-    for(int i=0;i<N*M;i+=M)
-    {
-        for(int j=i;j<(i+M);j++)
-            std::cout << vector3[j] << " ";
-        std::cout << "\n";
-    }*/
-
-    for(int count=0;count<10;count++)
-        Average += elapsed_count[count];
-
-    Average = Average/10.0;
-    printf("\nTime to compute Matrix Product (Copy + Computation + Copy) = %.12f\n",Average);
-
-    free(vector1_device,q);
-    free(vector2_device,q);
-    free(vector3_device,q);
-    free(vector1);
-    free(vector2);
-    free(vector3);
-
-    return 0;
+        vector2[i] = (i%7) * 0.5;
+
+    double reference_norm = 0.0;
+    for(int row=0;row<N;row++)
+        for(int col=0;col<M;col++)
+        {
+            double sum = 0.0;
+            for(int k=0;k<K;k++)
+                sum += vector1[row*K + k] * vector2[k*M + col];
+            reference[row*M + col] = sum;
+            reference_norm += sum*sum;
+        }
+    reference_norm = std::sqrt(reference_norm);
+
+    double err1 = Check<tiled_gemm::Config<double>>(q, default_time, vector1.data(), vector2.data(), reference.data(), reference_norm, N, M, K);
+    double err2 = Check<tiled_gemm::Config<double,32,32,8,2,2>>(q, small_time, vector1.data(), vector2.data(), reference.data(), reference_norm, N, M, K);
+
+    printf("\nMax error vs host (%dx%dx%d) : 64x64x16/4x4 = %g, 32x32x8/2x2 = %g\n",N,M,K,err1,err2);
+    printf("Time to compute Matrix Product (Copy + Computation + Copy) = %.12f / %.12f\n",
+           default_time.Summary().mean, small_time.Summary().mean);
+    default_time.Print();
+    small_time.Print();
+
+    return (err1 < 1e-9 && err2 < 1e-9) ? 0 : 1;
 }
@@ -1,57 +1,17 @@
 #include <sycl/sycl.hpp>
 #include<sys/sysinfo.h>
-#include<sys/time.h>
 #include "tbb/tbb.h"
+#include "harness.hpp"
 
 //using namespace hipsycl::sycl;
 using namespace sycl;
 
-unsigned long long rdtsc(void)
-{
-    unsigned long hi, lo;
-    __asm__ __volatile__ ("xorl %%eax, %%eax \n  cpuid" ::: "%eax", "%ebx", "%ecx", "%edx");
-    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
-}
-
-static inline unsigned long long int GetTickCount()
-{
-#ifdef WIN32
-    /* TODO find similar function on Windows */
-#else
-    struct timeval tp;
-    gettimeofday(&tp,NULL);
-    return tp.tv_sec*1000+tp.tv_usec/1000;
-}
-#endif
-
-void Calibrate(unsigned long long int *ClkPerSec,double NSecClk)
-{
-    unsigned long long int start,stop,diff;
-    unsigned long long int starttick,stoptick,difftick;
-
-    stoptick = GetTickCount();
-    while(stoptick == (starttick=GetTickCount()));
-
-    start = rdtsc();
-    while((stoptick=GetTickCount())<(starttick+500));
-    stop  = rdtsc();
-
-    diff = stop-start;
-    difftick = stoptick-starttick;
-
-    *ClkPerSec = ( diff * (unsigned long long int)1000 )/ (unsigned long long int)(difftick);
-    NSecClk = (double)1000000000 / (double)(__int64_t)*ClkPerSec;
-}
-
 int main(int argc,char *argv[])
 {
     const int N=40000,M=40000;
     int index;
-    unsigned long long int ClkPerSec;
-    double NSecClk;
-    unsigned long int start,end;
-    double elapsed_count[10],Average = 0.0;
+    harness::Options opts = harness::Options::FromEnv(atoi(argv[1]));
+    harness::Series stencil_time("VectorStencilA", opts);
 
     queue q(gpu_selector_v);
     //oneapi::tbb::global_control global_limit(oneapi::tbb::global_control::max_allowed_parallelism, atoi(argv[1]));
@@ -84,9 +44,7 @@ int main(int argc,char *argv[])
     auto *D_a = static_cast<float*>(malloc_device<float>(N*M,q));
     auto *D_Stencil = static_cast<float*>(malloc_device<float>((N-2)*(M-2),q));
 
-    Calibrate(&ClkPerSec,NSecClk);
-
-    for(int count = 0;count < atoi(argv[1]);count++)
+    for(int count = 0;count < stencil_time.iterations();count++)
     {
         if(FNorm[0] == 0.0f)
             FNorm[0] = 1.0f;
@@ -100,7 +58,7 @@ int main(int argc,char *argv[])
             std::cout << "\n";
         }*/
 
-        start = rdtsc(); 
+        harness::Timer timer(opts.clock);
 
         q.memcpy(D_a,H_a,(sizeof(float)*N*M)).wait();
 
@@ -127,10 +85,7 @@ int main(int argc,char *argv[])
 
         q.memcpy(H_a,D_a,sizeof(float)*N*M).wait();
     
-        end = rdtsc();
-    
-        elapsed_count[count] = (double)(end - start)/ClkPerSec;
-        //printf("TTC : %.12f\n",elapsed_count[count]);
+        stencil_time.Record(timer.Elapsed());
     }
 
     // Print updated Vector1 after Sum
@@ -144,12 +99,10 @@ int main(int argc,char *argv[])
     }*/
 
 
-    for(int count=0;count<(atoi(argv[1]));count++)
-        Average += elapsed_count[count];
-   
-    std::cout << "\nTime to compute 5pt-Stencil + Power Method (Total) = " << Average << "\n"; 
-    Average = Average/(atoi(argv[1]));
-    std::cout << "\nTime to compute (Avg over " << atoi(argv[1]) << " loops) = " << Average << "\n";
+    harness::Stats stats = stencil_time.Summary();
+    std::cout << "\nTime to compute 5pt-Stencil + Power Method (Total) = " << stats.mean * stats.count << "\n";
+    std::cout << "\nTime to compute (Avg over " << stats.count << " loops) = " << stats.mean << "\n";
+    stencil_time.Print();
 
     free(D_a,q);
     free(D_Stencil,q);
@@ -0,0 +1,182 @@
+//==============================================================
+// Shared benchmark harness, see harness.hpp.
+// =============================================================
+
+#include "harness.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HARNESS_HAVE_RDTSCP 1
+#else
+#define HARNESS_HAVE_RDTSCP 0
+#endif
+
+namespace harness {
+
+namespace {
+
+std::uint64_t SteadyNow()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// rdtscp waits for all prior instructions to retire; the trailing lfence
+// keeps later instructions from starting before the counter is read.  This
+// replaces the cpuid+rdtsc pair, which serialised the pipeline on every read.
+std::uint64_t ReadTsc()
+{
+#if HARNESS_HAVE_RDTSCP
+    unsigned int aux;
+    std::uint64_t ticks = __rdtscp(&aux);
+    _mm_lfence();
+    return ticks;
+#else
+    return SteadyNow();
+#endif
+}
+
+int EnvInt(const char *name, int fallback)
+{
+    const char *value = std::getenv(name);
+    if (value == nullptr || *value == '\0')
+        return fallback;
+
+    char *end = nullptr;
+    long parsed = std::strtol(value, &end, 10);
+    if (*end != '\0' || parsed < 0 || parsed > 1000000)
+        throw std::invalid_argument(std::string(name) + " must be a non-negative integer, got '" + value + "'");
+    return static_cast<int>(parsed);
+}
+
+double Percentile(const std::vector<double> &sorted, double fraction)
+{
+    // Linear interpolation between closest ranks.
+    double rank = fraction * (sorted.size() - 1);
+    std::size_t lower = static_cast<std::size_t>(rank);
+    std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (rank - lower) * (sorted[upper] - sorted[lower]);
+}
+
+}  // namespace
+
+Options Options::FromEnv(int repetitions)
+{
+    Options opts;
+    opts.repetitions = EnvInt("HARNESS_REPETITIONS", repetitions);
+    opts.warmup = EnvInt("HARNESS_WARMUP", opts.warmup);
+    if (opts.repetitions < 1)
+        throw std::invalid_argument("repetition count must be at least 1");
+
+    const char *clock = std::getenv("HARNESS_CLOCK");
+    if (clock != nullptr && *clock != '\0') {
+        if (std::strcmp(clock, "steady") == 0)
+            opts.clock = ClockKind::steady;
+        else if (std::strcmp(clock, "rdtscp") == 0)
+            opts.clock = ClockKind::rdtscp;
+        else
+            throw std::invalid_argument(std::string("HARNESS_CLOCK must be 'steady' or 'rdtscp', got '") + clock + "'");
+    }
+    return opts;
+}
+
+Stats Summarize(std::vector<double> samples)
+{
+    Stats stats;
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+    stats.count = samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = Percentile(samples, 0.5);
+    stats.p95 = Percentile(samples, 0.95);
+
+    double sum = 0.0;
+    for (double s : samples)
+        sum += s;
+    stats.mean = sum / samples.size();
+
+    double sq = 0.0;
+    for (double s : samples)
+        sq += (s - stats.mean) * (s - stats.mean);
+    stats.stddev = samples.size() > 1 ? std::sqrt(sq / (samples.size() - 1)) : 0.0;
+    return stats;
+}
+
+double TicksPerSecond()
+{
+#if HARNESS_HAVE_RDTSCP
+    // Calibrate against nanosecond steady_clock timestamps rather than the
+    // old millisecond gettimeofday() ticks, so 100 ms is already accurate to
+    // well below 0.01%.
+    static const double ticks_per_second = [] {
+        const std::uint64_t window_ns = 100000000;
+        std::uint64_t ns_start = SteadyNow();
+        std::uint64_t tsc_start = ReadTsc();
+        std::uint64_t ns_stop;
+        while ((ns_stop = SteadyNow()) - ns_start < window_ns)
+            ;
+        std::uint64_t tsc_stop = ReadTsc();
+        return (double)(tsc_stop - tsc_start) * 1e9 / (double)(ns_stop - ns_start);
+    }();
+    return ticks_per_second;
+#else
+    return 0.0;
+#endif
+}
+
+const char *ClockName(ClockKind clock)
+{
+    return clock == ClockKind::rdtscp ? "rdtscp" : "steady";
+}
+
+Timer::Timer(ClockKind clock) : clock_(clock)
+{
+    // Only rdtscp on a target that has it needs the calibrated frequency.
+    if (clock_ == ClockKind::rdtscp && TicksPerSecond() == 0.0)
+        clock_ = ClockKind::steady;
+    Start();
+}
+
+void Timer::Start()
+{
+    start_ = clock_ == ClockKind::rdtscp ? ReadTsc() : SteadyNow();
+}
+
+double Timer::Elapsed() const
+{
+    if (clock_ == ClockKind::rdtscp)
+        return (double)(ReadTsc() - start_) / TicksPerSecond();
+    return (double)(SteadyNow() - start_) * 1e-9;
+}
+
+Series::Series(std::string name, const Options &opts) : name_(std::move(name)), opts_(opts)
+{
+    samples_.reserve(opts_.repetitions);
+}
+
+void Series::Record(double seconds)
+{
+    if (seen_++ < opts_.warmup)
+        return;
+    samples_.push_back(seconds);
+}
+
+void Series::Print(std::FILE *out) const
+{
+    Stats s = Summary();
+    std::fprintf(out, "%s : median %.9f s, min %.9f s, mean %.9f s, p95 %.9f s, stddev %.9f s (n=%zu, warmup=%d, clock=%s)\n",
+                 name_.c_str(), s.median, s.min, s.mean, s.p95, s.stddev, s.count, opts_.warmup, ClockName(opts_.clock));
+}
+
+}  // namespace harness
@@ -0,0 +1,109 @@
+//==============================================================
+// Shared benchmark harness for the SYCL and CUDA drivers.
+//
+// Replaces the per-driver copies of rdtsc()/GetTickCount()/Calibrate().
+// A driver builds an Options (warmup, repetitions, clock backend), runs
+// Series::iterations() loop passes, times the region of interest with a
+// Timer and hands the seconds to Series::Record().  The first `warmup`
+// samples are discarded, the rest are summarised as min/median/mean/p95/
+// stddev.
+//
+// Environment overrides (read by Options::FromEnv):
+//   HARNESS_WARMUP=<n>          untimed warmup passes (default 1)
+//   HARNESS_REPETITIONS=<n>     timed passes (default: driver supplied)
+//   HARNESS_CLOCK=steady|rdtscp clock backend (default steady)
+// =============================================================
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace harness {
+
+enum class ClockKind { steady, rdtscp };
+
+struct Options {
+    int warmup = 1;
+    int repetitions = 10;
+    ClockKind clock = ClockKind::steady;
+
+    // Defaults with `repetitions` timed passes, then HARNESS_* overrides.
+    static Options FromEnv(int repetitions);
+};
+
+struct Stats {
+    std::size_t count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double stddev = 0.0;
+};
+
+// Summarise a set of samples (seconds).  An empty set gives all zeros.
+Stats Summarize(std::vector<double> samples);
+
+// Invariant TSC frequency, calibrated once per process against
+// steady_clock.  Returns 0 when the target has no rdtscp.
+double TicksPerSecond();
+
+const char *ClockName(ClockKind clock);
+
+// Starts on construction; Elapsed() returns seconds since the last Start().
+class Timer {
+ public:
+    explicit Timer(ClockKind clock = ClockKind::steady);
+
+    void Start();
+    double Elapsed() const;
+
+ private:
+    ClockKind clock_;
+    std::uint64_t start_;
+};
+
+// Collects the samples of one timed region.
+class Series {
+ public:
+    Series(std::string name, const Options &opts);
+
+    const std::string &name() const { return name_; }
+    const Options &options() const { return opts_; }
+
+    // Total loop passes the driver should run: warmup + repetitions.
+    int iterations() const { return opts_.warmup + opts_.repetitions; }
+
+    // Record one pass.  Passes before `warmup` has been reached are dropped.
+    void Record(double seconds);
+
+    const std::vector<double> &samples() const { return samples_; }
+    Stats Summary() const { return Summarize(samples_); }
+
+    // One line "name : median ... min ... mean ... p95 ... stddev ... (n=..)".
+    void Print(std::FILE *out = stdout) const;
+
+ private:
+    std::string name_;
+    Options opts_;
+    int seen_ = 0;
+    std::vector<double> samples_;
+};
+
+// Convenience loop for regions that fit in a callable: runs `body`
+// series.iterations() times, timing each call.
+template <class Body>
+Stats Run(Series &series, Body &&body)
+{
+    for (int count = 0; count < series.iterations(); count++) {
+        Timer timer(series.options().clock);
+        body();
+        series.Record(timer.Elapsed());
+    }
+    return series.Summary();
+}
+
+}  // namespace harness
@@ -0,0 +1,112 @@
+//==============================================================
+// Machine-readable result records, see report.hpp.
+// =============================================================
+
+#include "report.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace harness {
+
+namespace {
+
+bool UseCsv(const std::string &path)
+{
+    const char *format = std::getenv("HARNESS_FORMAT");
+    if (format != nullptr && *format != '\0') {
+        if (std::strcmp(format, "csv") == 0)
+            return true;
+        if (std::strcmp(format, "json") == 0)
+            return false;
+        throw std::invalid_argument(std::string("HARNESS_FORMAT must be 'csv' or 'json', got '") + format + "'");
+    }
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+}
+
+// Strings are quoted in both formats; only the quoting rules differ.
+std::string JsonString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string CsvString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+double Rate(double amount, double seconds)
+{
+    return seconds > 0.0 ? amount / seconds * 1e-9 : 0.0;
+}
+
+}  // namespace
+
+void WriteRecords(const RunInfo &info, const Series &series)
+{
+    const char *path = std::getenv("HARNESS_OUTPUT");
+    if (path == nullptr || *path == '\0')
+        return;
+
+    bool csv = UseCsv(path);
+    std::FILE *out = std::fopen(path, "a");
+    if (out == nullptr)
+        throw std::runtime_error(std::string("cannot open HARNESS_OUTPUT file '") + path + "'");
+
+    const char *clock = ClockName(series.options().clock);
+    const std::vector<double> &samples = series.samples();
+
+    if (csv) {
+        std::fseek(out, 0, SEEK_END);
+        if (std::ftell(out) == 0)
+            std::fprintf(out, "kernel,variant,series,device,memory,precision,sizes,iteration,seconds,bytes,flops,gflops,gbps,clock\n");
+
+        std::string sizes;
+        for (const auto &dim : info.sizes)
+            sizes += (sizes.empty() ? "" : ";") + dim.first + "=" + std::to_string(dim.second);
+
+        for (std::size_t i = 0; i < samples.size(); i++)
+            std::fprintf(out, "%s,%s,%s,%s,%s,%s,%s,%zu,%.12g,%.12g,%.12g,%.6g,%.6g,%s\n",
+                         CsvString(info.kernel).c_str(), CsvString(info.variant).c_str(),
+                         CsvString(series.name()).c_str(), CsvString(info.device).c_str(),
+                         CsvString(info.memory).c_str(), CsvString(info.precision).c_str(),
+                         CsvString(sizes).c_str(), i, samples[i], info.bytes, info.flops,
+                         Rate(info.flops, samples[i]), Rate(info.bytes, samples[i]), clock);
+    } else {
+        std::string sizes = "{";
+        for (const auto &dim : info.sizes)
+            sizes += (sizes.size() > 1 ? "," : "") + JsonString(dim.first) + ":" + std::to_string(dim.second);
+        sizes += "}";
+
+        for (std::size_t i = 0; i < samples.size(); i++)
+            std::fprintf(out, "{\"kernel\":%s,\"variant\":%s,\"series\":%s,\"device\":%s,\"memory\":%s,\"precision\":%s,"
+                              "\"sizes\":%s,\"iteration\":%zu,\"seconds\":%.12g,\"bytes\":%.12g,\"flops\":%.12g,"
+                              "\"gflops\":%.6g,\"gbps\":%.6g,\"clock\":\"%s\"}\n",
+                         JsonString(info.kernel).c_str(), JsonString(info.variant).c_str(),
+                         JsonString(series.name()).c_str(), JsonString(info.device).c_str(),
+                         JsonString(info.memory).c_str(), JsonString(info.precision).c_str(),
+                         sizes.c_str(), i, samples[i], info.bytes, info.flops,
+                         Rate(info.flops, samples[i]), Rate(info.bytes, samples[i]), clock);
+    }
+    std::fclose(out);
+}
+
+}  // namespace harness
@@ -0,0 +1,38 @@
+//==============================================================
+// Machine-readable result records for the benchmark drivers.
+//
+// A driver describes what it ran in a RunInfo and passes it together
+// with a Series to WriteRecords().  One record per timed repetition is
+// appended to the file named by HARNESS_OUTPUT; nothing is written when
+// the variable is unset, so the text output stays the default.
+//
+//   HARNESS_OUTPUT=results.csv    CSV, header written for a new file
+//   HARNESS_OUTPUT=results.jsonl  JSON Lines (any non-.csv name)
+//   HARNESS_FORMAT=csv|json       overrides the extension check
+// =============================================================
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "harness.hpp"
+
+namespace harness {
+
+struct RunInfo {
+    std::string kernel;     // e.g. "axpy", "gemm", "stencil"
+    std::string variant;    // driver / code path, e.g. "saxpy_usm"
+    std::string device;     // device name as reported by the runtime
+    std::string memory;     // "usm_device", "usm_shared", "buffer", ...
+    std::string precision;  // "fp32", "fp64", ...
+    std::vector<std::pair<std::string, long long>> sizes;  // {"n", 1024}, ...
+    double bytes = 0.0;     // bytes moved per repetition
+    double flops = 0.0;     // floating point operations per repetition
+};
+
+// Append one record per sample of `series` to HARNESS_OUTPUT.
+void WriteRecords(const RunInfo &info, const Series &series);
+
+}  // namespace harness